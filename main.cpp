@@ -1,18 +1,144 @@
 #include "stdio.h"
 #include <vector>
+#include <array>
 #include <random>
 #include <thread>
 #include <atomic>
 #include <string>
 #include <chrono>
+#include <mutex>
+#include <condition_variable>
+#include <functional>
+#include <memory>
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <cstdint>
+#include <immintrin.h>
+
+#ifdef _WIN32
+#define NOMINMAX
+#define WIN32_LEAN_AND_MEAN
+#include <windows.h>
+#else
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
+#ifdef __linux__
+#include <linux/perf_event.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#endif
+
+#ifdef _MSC_VER
+#include <intrin.h>
+#else
+#include <x86intrin.h>
+#endif
+
+#ifdef _MSC_VER
+#define TARGET_SSE42
+#define TARGET_AVX2
+#else
+#define TARGET_SSE42 __attribute__((target("sse4.2")))
+#define TARGET_AVX2 __attribute__((target("avx2")))
+#endif
 
 static const size_t c_maxValue = 2000;           // the sorted arrays will have values between 0 and this number in them (inclusive)
 static const size_t c_maxNumValues = 1000;       // the graphs will graph between 1 and this many values in a sorted array
 static const size_t c_numRunsPerTest = 100;      // how many times does it do the same test to gather min, max, average?
+static const size_t c_csvSeed = 0;               // seeds the random lists and search values of the csvs, so they come out the same every run
+static const size_t c_csvSizesPerBatch = 64;     // how many list sizes the csv sweep does at once, before writing out their rows
+static const size_t c_resultWriterBufferSize = 1 << 16; // how many bytes of rows the result writer collects before writing them to the file
 static const size_t c_perfTestNumSearches = 100000; // how many searches are going to be done per list type, to come up with timing for a search type.
+static const size_t c_batchInterleaveCount = 16;    // how many searches a batch search function keeps in flight at once
+static const size_t c_learnedIndexMaxError = 8;     // the learned index predicts where any value is to within this many indices
+static const size_t c_randomWalkMaxStep = 10;       // random walk search values move up or down by at most this much from one search to the next
+static const size_t c_rangeQueryMaxWidth = 200;     // range queries in the perf test are for [low, low + width], with width from 0 up to this
+static const size_t c_searchValueDistribution = 0;  // which of SearchValueFns in main() the csvs and perf test search for. 0 is uniform, like they always have.
+
+static const double c_zipfExponent = 1.1;             // how skewed zipf search values are. The search value of rank k is searched for in proportion to 1/k^this.
+static const size_t c_hotSetSize = 2048;              // how many different values hot set search values mostly search for...
+static const double c_hotSetFraction = 0.9;           // ...and what fraction of the searches are for them. The rest are uniform.
+static const size_t c_benchmarkNumSearches = 10000;  // how many searches the benchmark harness times one at a time, per repetition
+static const size_t c_benchmarkWarmupRuns = 2;       // how many times the benchmark harness does the searches before it starts timing them
+static const size_t c_benchmarkRepetitions = 10;     // how many timed repetitions the benchmark harness does, to get a confidence interval of the mean
+
+static const size_t c_interpolationTestMinLog2 = 20;                 // the interpolation precision test goes from lists of 2^this many values...
+static const size_t c_interpolationTestMaxLog2 = 26;                 // ...up to 2^this many values, 8 times bigger each time
+static const size_t c_interpolationTestMaxValue = size_t(1) << 56;   // the biggest key in the interpolation precision test. Much bigger than a float can hold exactly.
+static const size_t c_interpolationTestNumSearches = 100000;         // how many searches the interpolation precision test does per list and search
+
+static const size_t c_hotKeyCacheSize = 4096;         // how many slots are in the hot key cache. Must be a power of 2.
+static const size_t c_hotKeyCacheTestNumValues = 1 << 22; // how many values are in the list the hot key cache test searches. Big enough to not fit in cache.
+static const size_t c_hotKeyCacheTestNumSearches = 1 << 18; // how many searches the hot key cache test does per search value distribution and test
+
+static const size_t c_updatableDeltaMaxSize = 4096;         // how many inserts and removes the updatable list buffers before merging them into the sorted list
+static const size_t c_updatableTestNumValues = 1 << 20;     // how many values the updatable list starts out with in the mixed read / write test
+static const size_t c_updatableTestNumOperations = 1 << 20; // how many searches, inserts and removes the mixed read / write test does per write ratio and test
+
+static const size_t c_generatorChunkSize = 1 << 16;      // the dataset generators make lists in chunks of this many values, which are made in parallel
+static const double c_lognormalSigma = 1.0;              // the spread of the lognormal lists. The log of the values is normally distributed with this standard deviation.
+static const double c_zipfListExponent = 1.1;            // how skewed the zipf lists are. Value k shows up in proportion to 1/(k+1)^this.
+static const size_t c_clusterCount = 32;                 // how many clusters of values the clustered lists have, with empty gaps between them
+static const double c_timestampGapChance = 0.001;        // what fraction of the spacings between timestamps are gaps...
+static const double c_timestampGapLength = 1000.0;       // ...which are this many times longer than the other spacings, on average
+static const double c_outlierFraction = 0.001;           // what fraction of the values of a dense list are outliers, spread out above the dense values
+static const size_t c_generatorTestNumValues = 1 << 26;  // how many values the generator test makes with each generator, to time them
+
+static const size_t c_autoTuneSegmentSize = 4096;        // the auto tuner picks a search for each segment of this many values in a list
+static const size_t c_autoTuneProfileSamples = 256;      // how many values of a segment the profiler looks at to measure its shape
+static const size_t c_autoTuneProfileBlocks = 8;         // how many parts of a segment the profiler compares the density of
+static const size_t c_autoTuneNumSearches = 256;         // how many searches the auto tuner times each search with, per segment
+static const double c_autoTuneMaxLineFitResidual = 0.05; // line fit isn't tried on segments with a value further than this fraction of the segment from the end point fit
+static const size_t c_autoTuneMaxLinearSearch = 64;      // linear search is only tried on segments of at most this many values
+static const size_t c_autoTuneTestNumValues = 1 << 20;   // how many values are in the lists the auto tuner test makes plans for
+static const size_t c_autoTuneTestNumSearches = 100000;  // how many searches the auto tuner test times per list, with the plan and with each search on its own
+
+static const size_t c_stringKeyTestNumKeys = 1 << 20;      // how many keys are in the lists of string and composite keys
+static const size_t c_stringKeyTestNumSearches = 100000;   // how many searches the string key test times per list and search
+static const uint32_t c_stringKeyTestNumTenants = 100;     // how many tenants the tenant and timestamp keys are spread over
+
+static const size_t c_compressedBlockSize = 128;            // how many values are in each block of a compressed list
+static const size_t c_compressedTestNumValues = 1 << 22;    // how many values are in the lists the compressed list test makes. 32MB uncompressed.
+static const size_t c_compressedTestNumSearches = 1 << 19;  // how many searches the compressed list test times per list and search
+
+static const size_t c_sizeSweepMinLog2 = 4;          // the size sweep starts with lists of 2^this many values
+static const size_t c_sizeSweepMaxLog2 = 24;         // and doubles the size until it gets to 2^this many values. 2^27 values is 1GB per list.
+static const size_t c_sizeSweepValueScale = 2;       // the values in the size sweep lists go up to this many times the number of values
+static const size_t c_sizeSweepNumSearches = 100000; // how many searches the size sweep does per list and test...
+static const double c_sizeSweepSecondsPerTest = 0.1; // ...unless it takes longer than this many seconds
+
+static const size_t c_parallelTestNumValues = 1 << 22;   // how many values are in the list the multithreaded test searches. Big enough to not fit in cache.
+static const size_t c_parallelTestNumSearches = 1 << 20; // how many searches the multithreaded test does per thread count
+static const size_t c_parallelSearchChunkSize = 1024;    // how many searches are in each task given to the thread pool
+
+static const size_t c_hugePageTestNumValues = 1 << 26;  // how many values are in the list the huge page test searches. 512MB, so the TLB can't cover it with small pages.
+static const size_t c_hugePageTestNumSearches = 1 << 19; // how many searches the huge page test times per page size and search
+
+static const size_t c_mappedFileNumValues = 1 << 22;  // how many values are in the sorted list file the memory mapped test writes and searches
+static const size_t c_mappedFileNumSearches = 10000;  // how many searches are timed on the memory mapped list, cold and then warm
 
 #define VERIFY_RESULT() 1 // verifies that the search functions got the right answer. prints out a message if they didn't.
 #define MAKE_CSVS() 1 // the main test
+#define BINARY_RESULTS() 0 // writes the csv sweep and size sweep results as binary files of doubles (.bin) instead of as csvs
+#define PERF_TEST_KEY_TYPES() 1 // perf tests the searches for each key type, called directly instead of through function pointers
+#define SIZE_SWEEP() 1 // makes csvs of search speed and guesses as the list size goes from L1 cache sized to main memory sized
+#define HUGE_PAGE_TEST() 1 // times searching a big list in an arena with small pages, transparent huge pages, 2MB pages and 1GB pages, and copied to each NUMA node
+#define MAPPED_FILE_TEST() 1 // writes a sorted list to disk, and times searching it through a memory mapping, with cold and warm pages
+#define PARALLEL_TEST() 1 // times searching a big list from 1 thread up to as many threads as there are cores
+#define BENCHMARK_HARNESS() 1 // times each search one at a time, to report percentiles and confidence intervals, with warm and cold caches
+#define INTERPOLATION_PRECISION_TEST() 1 // compares float and integer line fit on big lists with big keys
+#define HOT_KEY_CACHE_TEST() 1 // times searches for skewed search values with and without a hot key cache in front of them
+#define UPDATABLE_LIST_TEST() 1 // times mixes of searches, inserts and removes on a sorted list that buffers its updates and merges them in the background
+#define GENERATOR_TEST() 1 // times making big lists with each list function, on all cores
+#define STRING_KEY_TEST() 1 // searches lists of string keys and composite keys, through an integer prefix of each key
+#define COMPRESSED_LIST_TEST() 1 // compresses lists into bit packed blocks, and times searching them against searching the uncompressed lists
+#define AUTO_TUNE_TEST() 1 // profiles lists, picks the fastest search for each segment of them, saves the plans to files, and times the plans
+#define PERF_COUNTERS() 1 // reports hardware performance counters per search in the perf test, where the OS supports it (linux perf_event_open)
 
 struct TestResults
 {
@@ -21,8 +147,22 @@ struct TestResults
     size_t guesses;
 };
 
-using MakeListFn = void(*)(std::vector<size_t>& values, size_t count);
+using MakeListFn = void(*)(std::vector<size_t>& values, size_t count, size_t maxValue, std::mt19937& rng);
 using TestListFn = TestResults(*)(const std::vector<size_t>& values, size_t searchValue);
+using MakeLayoutFn = void(*)(const std::vector<size_t>& values, std::vector<size_t>& layout);
+using TestListBatchFn = void(*)(const std::vector<size_t>& values, const size_t* searchValues, size_t count, TestResults* results);
+using TestListHintedFn = TestResults(*)(const std::vector<size_t>& values, size_t searchValue, size_t hintIndex);
+using MakeSearchValuesFn = void(*)(std::vector<size_t>& searchValues, size_t count, size_t maxValue, std::mt19937& rng);
+
+// The range of values in [low, high] is the indices [lowerBound, upperBound), so there are upperBound - lowerBound of them.
+struct RangeResults
+{
+    size_t lowerBound;  // the index of the first value >= low
+    size_t upperBound;  // the index of the first value > high
+    size_t guesses;
+};
+
+using TestListRangeFn = RangeResults(*)(const std::vector<size_t>& values, size_t low, size_t high);
 
 struct MakeListInfo
 {
@@ -34,6 +174,31 @@ struct TestListInfo
 {
     const char* name;
     TestListFn fn;
+    MakeLayoutFn layoutFn; // if not null, the sorted list is rearranged by this function, and the result is what gets passed to fn.
+};
+
+struct TestListBatchInfo
+{
+    const char* name;
+    TestListBatchFn fn;
+};
+
+struct TestListHintedInfo
+{
+    const char* name;
+    TestListHintedFn fn;
+};
+
+struct TestListRangeInfo
+{
+    const char* name;
+    TestListRangeFn fn;
+};
+
+struct MakeSearchValuesInfo
+{
+    const char* name;
+    MakeSearchValuesFn fn;
 };
 
 #define countof(array) (sizeof(array) / sizeof(array[0]))
@@ -49,97 +214,279 @@ T Clamp(T min, T max, T value)
         return value;
 }
 
+// A non owning view of an array, so searches can run on memory that isn't in a std::vector.
+template <typename T>
+struct ArrayView
+{
+    using value_type = T;
+
+    ArrayView(const T* data, size_t size) : m_data(data), m_size(size) {}
+
+    const T* data() const { return m_data; }
+    size_t size() const { return m_size; }
+    const T& operator[](size_t index) const { return m_data[index]; }
+    const T* begin() const { return m_data; }
+    const T* end() const { return m_data + m_size; }
+
+private:
+    const T* m_data;
+    size_t m_size;
+};
+
+// An ArrayView of a sorted list whose first and last values, and the line fit between them, are already known, like they
+// are from the header of a sorted list file. The searches that start from the end points get them from here, so they
+// don't read the first and last values, which would touch the first and last pages of a memory mapped list.
+template <typename T>
+struct EndPointArrayView : public ArrayView<T>
+{
+    EndPointArrayView(const T* data, size_t size, T first, T last, float lineFitM, float lineFitB)
+        : ArrayView<T>(data, size), m_first(first), m_last(last), m_lineFitM(lineFitM), m_lineFitB(lineFitB) {}
+
+    T First() const { return m_first; }
+    T Last() const { return m_last; }
+    float LineFitM() const { return m_lineFitM; }
+    float LineFitB() const { return m_lineFitB; }
+
+private:
+    T m_first;
+    T m_last;
+    float m_lineFitM;  // the line fit of the end points: value = m * index + b
+    float m_lineFitB;
+};
+
+// The first and last values of a list, and the line fit of them, read from the list, or taken from an EndPointArrayView
+template <typename TValues>
+inline typename TValues::value_type FirstValue(const TValues& values) { return values[0]; }
+
+template <typename TValues>
+inline typename TValues::value_type LastValue(const TValues& values) { return values[values.size() - 1]; }
+
+template <typename TValues>
+inline void EndPointLineFit(const TValues& values, float& m, float& b)
+{
+    // y = mx + b
+    // m = rise / run
+    // b = y - mx, which is the first value, at x = 0
+    m = (float(LastValue(values)) - float(FirstValue(values))) / float(values.size() - 1);
+    b = float(FirstValue(values));
+}
+
+template <typename T>
+inline T FirstValue(const EndPointArrayView<T>& values) { return values.First(); }
+
+template <typename T>
+inline T LastValue(const EndPointArrayView<T>& values) { return values.Last(); }
+
+template <typename T>
+inline void EndPointLineFit(const EndPointArrayView<T>& values, float& m, float& b)
+{
+    m = values.LineFitM();
+    b = values.LineFitB();
+}
+
 float Lerp(float a, float b, float t)
 {
     return (1.0f - t) * a + t * b;
 }
 
-// ------------------------ MAKE LIST FUNCTIONS ------------------------
+inline void Prefetch(const void* address)
+{
+    _mm_prefetch((const char*)address, _MM_HINT_T0);
+}
 
-void MakeList_Random(std::vector<size_t>& values, size_t count)
+// value must not be zero
+inline size_t CountTrailingZeros(size_t value)
 {
-    std::uniform_int_distribution<size_t> dist(0, c_maxValue);
+#ifdef _MSC_VER
+    unsigned long index;
+#ifdef _WIN64
+    _BitScanForward64(&index, value);
+#else
+    _BitScanForward(&index, value);
+#endif
+    return index;
+#else
+    return __builtin_ctzll(value);
+#endif
+}
 
-    static std::random_device rd("dev/random");
-    static std::seed_seq fullSeed{ rd(), rd(), rd(), rd(), rd(), rd(), rd(), rd() };
-    static std::mt19937 rng(fullSeed);
+// a * b / c, rounded to the nearest integer. The product is 128 bits so it can't overflow, which makes the result exact.
+// c must not be zero, and the result must fit in 64 bits.
+inline uint64_t MulDivRound(uint64_t a, uint64_t b, uint64_t c)
+{
+#ifdef _MSC_VER
+    uint64_t high;
+    uint64_t low = _umul128(a, b, &high);
+    uint64_t half = c / 2;
+    low += half;
+    high += (low < half) ? 1 : 0;
+    uint64_t remainder;
+    return _udiv128(high, low, c, &remainder);
+#else
+    unsigned __int128 product = (unsigned __int128)a * b + c / 2;
+    return uint64_t(product / c);
+#endif
+}
+
+struct CPUFeatures
+{
+    bool sse42;
+    bool avx2;
+};
+
+CPUFeatures DetectCPUFeatures()
+{
+    CPUFeatures ret;
+#ifdef _MSC_VER
+    int info[4];
+    __cpuid(info, 0);
+    int maxFunction = info[0];
+
+    __cpuid(info, 1);
+    ret.sse42 = (info[2] & (1 << 20)) != 0;
+    bool osxsave = (info[2] & (1 << 27)) != 0;
+    bool avx = (info[2] & (1 << 28)) != 0;
+
+    // AVX2 also needs the OS to save the ymm registers on a context switch
+    ret.avx2 = false;
+    if (maxFunction >= 7 && osxsave && avx && (_xgetbv(0) & 6) == 6)
+    {
+        __cpuidex(info, 7, 0);
+        ret.avx2 = (info[1] & (1 << 5)) != 0;
+    }
+#else
+    __builtin_cpu_init();
+    ret.sse42 = __builtin_cpu_supports("sse4.2") != 0;
+    ret.avx2 = __builtin_cpu_supports("avx2") != 0;
+#endif
+    return ret;
+}
+
+const CPUFeatures& GetCPUFeatures()
+{
+    static const CPUFeatures features = DetectCPUFeatures();
+    return features;
+}
+
+// ------------------------ MAKE LIST FUNCTIONS ------------------------
+
+template <typename TKey>
+void MakeList_Random(std::vector<TKey>& values, size_t count, size_t maxValue, std::mt19937& rng)
+{
+    std::uniform_int_distribution<size_t> dist(0, maxValue);
 
     values.resize(count);
-    for (size_t& v : values)
-        v = dist(rng);
+    for (TKey& v : values)
+        v = TKey(dist(rng));
 
     std::sort(values.begin(), values.end());
 }
 
-void MakeList_Linear(std::vector<size_t>& values, size_t count)
+template <typename TKey>
+void MakeList_Linear(std::vector<TKey>& values, size_t count, size_t maxValue, std::mt19937& rng)
 {
     values.resize(count);
     for (size_t index = 0; index < count; ++index)
     {
-        float x = float(index) / (count > 1 ? float(count - 1) : 1);
-        float y = x;
-        y *= c_maxValue;
-        values[index] = size_t(y);
+        double x = double(index) / (count > 1 ? double(count - 1) : 1);
+        double y = x;
+        y *= double(maxValue);
+        values[index] = TKey(size_t(y));
     }
-
-    std::sort(values.begin(), values.end());
 }
 
-void MakeList_Linear_Outlier(std::vector<size_t>& values, size_t count)
+template <typename TKey>
+void MakeList_Linear_Outlier(std::vector<TKey>& values, size_t count, size_t maxValue, std::mt19937& rng)
 {
-    MakeList_Linear(values, count);
-    *values.rbegin() = c_maxValue * 100;
+    MakeList_Linear(values, count, maxValue, rng);
+    *values.rbegin() = TKey(maxValue * 100);
 }
 
-void MakeList_Quadratic(std::vector<size_t>& values, size_t count)
+template <typename TKey>
+void MakeList_Quadratic(std::vector<TKey>& values, size_t count, size_t maxValue, std::mt19937& rng)
 {
     values.resize(count);
     for (size_t index = 0; index < count; ++index)
     {
-        float x = float(index) / (count > 1 ? float(count - 1) : 1);
-        float y = x * x;
-        y *= c_maxValue;
-        values[index] = size_t(y);
+        double x = double(index) / (count > 1 ? double(count - 1) : 1);
+        double y = x * x;
+        y *= double(maxValue);
+        values[index] = TKey(size_t(y));
     }
-
-    std::sort(values.begin(), values.end());
 }
 
-void MakeList_Cubic(std::vector<size_t>& values, size_t count)
+template <typename TKey>
+void MakeList_Cubic(std::vector<TKey>& values, size_t count, size_t maxValue, std::mt19937& rng)
 {
     values.resize(count);
     for (size_t index = 0; index < count; ++index)
     {
-        float x = float(index) / (count > 1 ? float(count-1) : 1);
-        float y = x * x * x;
-        y *= c_maxValue;
-        values[index] = size_t(y);
+        double x = double(index) / (count > 1 ? double(count - 1) : 1);
+        double y = x * x * x;
+        y *= double(maxValue);
+        values[index] = TKey(size_t(y));
     }
-
-    std::sort(values.begin(), values.end());
 }
 
-void MakeList_Log(std::vector<size_t>& values, size_t count)
+template <typename TKey>
+void MakeList_Log(std::vector<TKey>& values, size_t count, size_t maxValue, std::mt19937& rng)
 {
     values.resize(count);
 
-    float maxValue = log(float(count));
+    double maxLog = log(double(count));
 
     for (size_t index = 0; index < count; ++index)
     {
-        float x = float(index + 1);
-        float y = log(x+1) / maxValue;
-        y *= c_maxValue;
-        values[index] = size_t(y);
+        double x = double(index + 1);
+        double y = log(x+1) / maxLog;
+        y *= double(maxValue);
+        values[index] = TKey(size_t(y));
+    }
+}
+
+// Joins pieces made by the other list functions end to end, so the shape of the list changes along it
+template <typename TKey>
+void MakeList_Mixed(std::vector<TKey>& values, size_t count, size_t maxValue, std::mt19937& rng)
+{
+    typedef void(*MakePieceFn)(std::vector<TKey>& values, size_t count, size_t maxValue, std::mt19937& rng);
+    static const MakePieceFn pieceFns[] =
+    {
+        MakeList_Random<TKey>,
+        MakeList_Linear<TKey>,
+        MakeList_Quadratic<TKey>,
+        MakeList_Log<TKey>,
+        MakeList_Cubic<TKey>,
+    };
+    static const size_t numPieces = countof(pieceFns);
+
+    values.clear();
+    values.reserve(count);
+    std::vector<TKey> piece;
+    for (size_t pieceIndex = 0; pieceIndex < numPieces; ++pieceIndex)
+    {
+        size_t pieceBegin = count * pieceIndex / numPieces;
+        size_t pieceCount = count * (pieceIndex + 1) / numPieces - pieceBegin;
+        size_t valueBegin = maxValue * pieceIndex / numPieces;
+        size_t valueRange = maxValue * (pieceIndex + 1) / numPieces - valueBegin;
+        if (pieceCount == 0)
+            continue;
+
+        pieceFns[pieceIndex](piece, pieceCount, valueRange, rng);
+        for (TKey v : piece)
+            values.push_back(TKey(valueBegin + size_t(v)));
     }
 
+    // the log piece goes a little past its value range
     std::sort(values.begin(), values.end());
 }
 
 // ------------------------ TEST LIST FUNCTIONS ------------------------
 
-TestResults TestList_LinearSearch(const std::vector<size_t>& values, size_t searchValue)
+template <typename TValues>
+TestResults TestList_LinearSearch(const TValues& values, typename TValues::value_type searchValue)
 {
+    using TKey = typename TValues::value_type;
+
     TestResults ret;
     ret.found = false;
     ret.guesses = 0;
@@ -151,7 +498,7 @@ TestResults TestList_LinearSearch(const std::vector<size_t>& values, size_t sear
             break;
         ret.guesses++;
 
-        size_t value = values[ret.index];
+        TKey value = values[ret.index];
         if (value == searchValue)
         {
             ret.found = true;
@@ -166,7 +513,8 @@ TestResults TestList_LinearSearch(const std::vector<size_t>& values, size_t sear
     return ret;
 }
 
-TestResults TestList_LineFit(const std::vector<size_t>& values, size_t searchValue)
+template <typename TValues>
+TestResults TestList_LineFit(const TValues& values, typename TValues::value_type searchValue)
 {
     // The idea of this test is that we keep a fit of a line y=mx+b
     // of the left and right side known data points, and use that
@@ -179,11 +527,13 @@ TestResults TestList_LineFit(const std::vector<size_t>& values, size_t searchVal
     // but doesn't include the min and max reads at the beginning because
     // those could reasonably be done in advance.
 
+    using TKey = typename TValues::value_type;
+
     // get the starting min and max value.
     size_t minIndex = 0;
     size_t maxIndex = values.size() - 1;
-    size_t min = values[minIndex];
-    size_t max = values[maxIndex];
+    TKey min = FirstValue(values);
+    TKey max = LastValue(values);
 
     TestResults ret;
     ret.found = true;
@@ -214,11 +564,8 @@ TestResults TestList_LineFit(const std::vector<size_t>& values, size_t searchVal
     }
 
     // fit a line to the end points
-    // y = mx + b
-    // m = rise / run
-    // b = y - mx
-    float m = (float(max) - float(min)) / float(maxIndex - minIndex);
-    float b = float(min) - m * float(minIndex);
+    float m, b;
+    EndPointLineFit(values, m, b);
 
     while (1)
     {
@@ -226,7 +573,7 @@ TestResults TestList_LineFit(const std::vector<size_t>& values, size_t searchVal
         ret.guesses++;
         size_t guessIndex = size_t(0.5f + (float(searchValue) - b) / m);
         guessIndex = Clamp(minIndex + 1, maxIndex - 1, guessIndex);
-        size_t guess = values[guessIndex];
+        TKey guess = values[guessIndex];
 
         // if we found it, return success
         if (guess == searchValue)
@@ -264,18 +611,21 @@ TestResults TestList_LineFit(const std::vector<size_t>& values, size_t searchVal
     return ret;
 }
 
-TestResults TestList_HybridSearch(const std::vector<size_t>& values, size_t searchValue)
+template <typename TValues>
+TestResults TestList_HybridSearch(const TValues& values, typename TValues::value_type searchValue)
 {
     // On even iterations, this does a line fit step.
     // On odd iterations, this does a binary search step.
     // Line fit can do better than binary search, but it can also get trapped in situations that it does poorly.
     // The binary search step is there to help it break out of those situations.
 
+    using TKey = typename TValues::value_type;
+
     // get the starting min and max value.
     size_t minIndex = 0;
     size_t maxIndex = values.size() - 1;
-    size_t min = values[minIndex];
-    size_t max = values[maxIndex];
+    TKey min = FirstValue(values);
+    TKey max = LastValue(values);
 
     TestResults ret;
     ret.found = true;
@@ -306,11 +656,8 @@ TestResults TestList_HybridSearch(const std::vector<size_t>& values, size_t sear
     }
 
     // fit a line to the end points
-    // y = mx + b
-    // m = rise / run
-    // b = y - mx
-    float m = (float(max) - float(min)) / float(maxIndex - minIndex);
-    float b = float(min) - m * float(minIndex);
+    float m, b;
+    EndPointLineFit(values, m, b);
 
     bool doBinaryStep = false;
     while (1)
@@ -319,7 +666,7 @@ TestResults TestList_HybridSearch(const std::vector<size_t>& values, size_t sear
         ret.guesses++;
         size_t guessIndex = doBinaryStep ? (minIndex + maxIndex) / 2 : size_t(0.5f + (float(searchValue) - b) / m);
         guessIndex = Clamp(minIndex + 1, maxIndex - 1, guessIndex);
-        size_t guess = values[guessIndex];
+        TKey guess = values[guessIndex];
 
         // if we found it, return success
         if (guess == searchValue)
@@ -360,8 +707,128 @@ TestResults TestList_HybridSearch(const std::vector<size_t>& values, size_t sear
     return ret;
 }
 
-TestResults TestList_BinarySearch(const std::vector<size_t>& values, size_t searchValue)
+template <typename TValues>
+TestResults TestList_AdaptiveSearch(const TValues& values, typename TValues::value_type searchValue)
+{
+    // Like the hybrid search, this mixes line fit and binary search steps, but it decides which to do based on
+    // how well the line fit is doing, instead of blindly alternating.
+    // A line fit step that shrinks the unknown area to half or less is doing at least as well as binary search, so
+    // line fit keeps going. When a line fit step does worse than that, it switches to binary search steps, doing twice
+    // as many each time line fit fails again in a row, before giving line fit another try.
+    // Every binary step at least halves the unknown area, and every line fit step is either also a halving step, or is
+    // followed by at least one binary step, so this never takes more than about 2 * log2(n) guesses.
+
+    using TKey = typename TValues::value_type;
+
+    // get the starting min and max value.
+    size_t minIndex = 0;
+    size_t maxIndex = values.size() - 1;
+    TKey min = FirstValue(values);
+    TKey max = LastValue(values);
+
+    TestResults ret;
+    ret.found = true;
+    ret.guesses = 0;
+
+    // if we've already found the value, we are done
+    if (searchValue < min)
+    {
+        ret.index = minIndex;
+        ret.found = false;
+        return ret;
+    }
+    if (searchValue > max)
+    {
+        ret.index = maxIndex;
+        ret.found = false;
+        return ret;
+    }
+    if (searchValue == min)
+    {
+        ret.index = minIndex;
+        return ret;
+    }
+    if (searchValue == max)
+    {
+        ret.index = maxIndex;
+        return ret;
+    }
+
+    size_t binaryStepsLeft = 0;     // how many binary steps to do before trying line fit again
+    size_t lineFitFailures = 0;     // how many line fit steps in a row have done worse than a binary step would have
+    while (1)
+    {
+        // make a guess based on a line fit of the end points, or in the middle if doing binary steps
+        ret.guesses++;
+        bool doBinaryStep = binaryStepsLeft > 0;
+        size_t guessIndex;
+        if (doBinaryStep)
+        {
+            guessIndex = (minIndex + maxIndex) / 2;
+        }
+        else
+        {
+            float m = (float(max) - float(min)) / float(maxIndex - minIndex);
+            float b = float(min) - m * float(minIndex);
+            guessIndex = size_t(0.5f + (float(searchValue) - b) / m);
+        }
+        guessIndex = Clamp(minIndex + 1, maxIndex - 1, guessIndex);
+        TKey guess = values[guessIndex];
+
+        // if we found it, return success
+        if (guess == searchValue)
+        {
+            ret.index = guessIndex;
+            return ret;
+        }
+
+        size_t oldWidth = maxIndex - minIndex;
+
+        // if we were too low, this is our new minimum
+        if (guess < searchValue)
+        {
+            minIndex = guessIndex;
+            min = guess;
+        }
+        // else we were too high, this is our new maximum
+        else
+        {
+            maxIndex = guessIndex;
+            max = guess;
+        }
+
+        // if we run out of places to look, we didn't find it
+        if (minIndex + 1 >= maxIndex)
+        {
+            ret.index = minIndex;
+            ret.found = false;
+            return ret;
+        }
+
+        // decide what to do next
+        if (doBinaryStep)
+        {
+            binaryStepsLeft--;
+        }
+        else if ((maxIndex - minIndex) * 2 <= oldWidth)
+        {
+            lineFitFailures = 0;
+        }
+        else
+        {
+            lineFitFailures = std::min(lineFitFailures + 1, size_t(16));
+            binaryStepsLeft = size_t(1) << (lineFitFailures - 1);
+        }
+    }
+
+    return ret;
+}
+
+template <typename TValues>
+TestResults TestList_BinarySearch(const TValues& values, typename TValues::value_type searchValue)
 {
+    using TKey = typename TValues::value_type;
+
     TestResults ret;
     ret.found = false;
     ret.guesses = 0;
@@ -373,7 +840,7 @@ TestResults TestList_BinarySearch(const std::vector<size_t>& values, size_t sear
         // make a guess by looking in the middle of the unknown area
         ret.guesses++;
         size_t guessIndex = (minIndex + maxIndex) / 2;
-        size_t guess = values[guessIndex];
+        TKey guess = values[guessIndex];
 
         // found it
         if (guess == searchValue)
@@ -410,7 +877,8 @@ TestResults TestList_BinarySearch(const std::vector<size_t>& values, size_t sear
     return ret;
 }
 
-TestResults TestList_LineFitBlind(const std::vector<size_t>& values, size_t searchValue)
+template <typename TValues>
+TestResults TestList_LineFitBlind(const TValues& values, typename TValues::value_type searchValue)
 {
     // If you want to know how this does against binary search without first knowing the min and max, this result is for you.
     // It takes 2 extra samples to get the min and max, so we are counting those as guesses (memory reads).
@@ -419,184 +887,5671 @@ TestResults TestList_LineFitBlind(const std::vector<size_t>& values, size_t sear
     return ret;
 }
 
-// ------------------------ MAIN ------------------------
-
-void VerifyResults(const std::vector<size_t>& values, size_t searchValue, const TestResults& result, const char* list, const char* test)
+// Line fit and hybrid search, but with the guess made with exact integer math instead of floats. A float only has 24 bits
+// of mantissa, so with more than 2^24 values, or keys bigger than 2^24, the float guess can be off by a lot, which costs
+// extra guesses. The line through (minIndex, min) and (maxIndex, max) gives
+//   guessIndex = minIndex + (searchValue - min) * (maxIndex - minIndex) / (max - min)
+// which is done with a 128 bit product, so it's exact for any list size and any integer key size.
+// That's one integer multiply and divide per step, where the float version divides twice: to make the slope, and to use it.
+// This is only for integer keys.
+template <typename TValues, bool HYBRID>
+TestResults InterpolationSearchInteger(const TValues& values, typename TValues::value_type searchValue)
 {
-    #if VERIFY_RESULT()
-    // verify correctness of result by comparing to a linear search
-    TestResults actualResult = TestList_LinearSearch(values, searchValue);
-    if (result.found != actualResult.found)
+    using TKey = typename TValues::value_type;
+
+    // get the starting min and max value.
+    size_t minIndex = 0;
+    size_t maxIndex = values.size() - 1;
+    TKey min = FirstValue(values);
+    TKey max = LastValue(values);
+
+    TestResults ret;
+    ret.found = true;
+    ret.guesses = 0;
+
+    // if we've already found the value, we are done
+    if (searchValue < min)
     {
-        printf("VERIFICATION FAILURE!! (found %s vs %s) %s, %s\n", result.found ? "true" : "false", actualResult.found ? "true" : "false", list, test);
+        ret.index = minIndex;
+        ret.found = false;
+        return ret;
     }
-    else if (result.found == true && result.index != actualResult.index && values[result.index] != values[actualResult.index])
+    if (searchValue > max)
     {
-        // Note that in the case of duplicates, different algorithms may return different indices, but the values stored in them should be the same
-        printf("VERIFICATION FAILURE!! (index %zu vs %zu) %s, %s\n", result.index, actualResult.index, list, test);
+        ret.index = maxIndex;
+        ret.found = false;
+        return ret;
     }
-    // verify that the index returned is a reasonable place for the value to be inserted, if the value was not found.
-    else if (result.found == false)
+    if (searchValue == min)
     {
-        bool gte = true;
-        bool lte = true;
-
-        if (result.index > 0)
-            gte = searchValue >= values[result.index - 1];
-
-        if (result.index + 1 < values.size())
-            lte = searchValue <= values[result.index + 1];
-
-        if (gte == false || lte == false)
-            printf("VERIFICATION FAILURE!! Not a valid place to insert a new value! %s, %s\n", list, test);
+        ret.index = minIndex;
+        return ret;
+    }
+    if (searchValue == max)
+    {
+        ret.index = maxIndex;
+        return ret;
     }
 
-    #endif
-}
+    // min < searchValue < max from here on, so the differences are never negative, and max - min is never zero
+    bool doBinaryStep = false;
+    while (1)
+    {
+        // make a guess based on the line between min and max, or by binary search if it's a hybrid binary step
+        ret.guesses++;
+        size_t guessIndex = doBinaryStep
+            ? (minIndex + maxIndex) / 2
+            : minIndex + size_t(MulDivRound(uint64_t(searchValue - min), uint64_t(maxIndex - minIndex), uint64_t(max - min)));
+        guessIndex = Clamp(minIndex + 1, maxIndex - 1, guessIndex);
+        TKey guess = values[guessIndex];
+
+        // if we found it, return success
+        if (guess == searchValue)
+        {
+            ret.index = guessIndex;
+            return ret;
+        }
+
+        // if we were too low, this is our new minimum
+        if (guess < searchValue)
+        {
+            minIndex = guessIndex;
+            min = guess;
+        }
+        // else we were too high, this is our new maximum
+        else
+        {
+            maxIndex = guessIndex;
+            max = guess;
+        }
+
+        // if we run out of places to look, we didn't find it
+        if (minIndex + 1 >= maxIndex)
+        {
+            ret.index = minIndex;
+            ret.found = false;
+            return ret;
+        }
+
+        if (HYBRID)
+            doBinaryStep = !doBinaryStep;
+    }
+
+    return ret;
+}
+
+template <typename TValues>
+TestResults TestList_LineFitInteger(const TValues& values, typename TValues::value_type searchValue)
+{
+    return InterpolationSearchInteger<TValues, false>(values, searchValue);
+}
+
+template <typename TValues>
+TestResults TestList_HybridSearchInteger(const TValues& values, typename TValues::value_type searchValue)
+{
+    return InterpolationSearchInteger<TValues, true>(values, searchValue);
+}
+
+// ------------------------ BRANCHLESS AND SIMD TEST FUNCTIONS ------------------------
+
+// These searches find the lower bound (the index of the first value >= searchValue) without any early out,
+// so that the loop doesn't depend on branch prediction, which is a coin flip for random search values.
+// This turns the lower bound into the same results the other searches give.
+// lastGuessIndex is the last index the search read, which doesn't need to be read (counted) again.
+template <typename TKey>
+void LowerBoundToResults(const TKey* values, size_t count, TKey searchValue, size_t lowerBound, size_t lastGuessIndex, TestResults& ret)
+{
+    // if everything is smaller than the search value, it goes after the last value
+    if (lowerBound >= count)
+    {
+        ret.found = false;
+        ret.index = count - 1;
+        return;
+    }
+
+    if (lowerBound != lastGuessIndex)
+        ret.guesses++;
+    ret.found = values[lowerBound] == searchValue;
+    ret.index = lowerBound;
+}
+
+template <typename TValues>
+TestResults TestList_BranchlessBinarySearch(const TValues& values, typename TValues::value_type searchValue)
+{
+    using TKey = typename TValues::value_type;
+
+    TestResults ret;
+    ret.found = false;
+    ret.guesses = 0;
+
+    // base always points at a value < searchValue, or at the first value.
+    // The ternary becomes a conditional move instead of a branch.
+    const TKey* base = values.data();
+    size_t count = values.size();
+    while (count > 1)
+    {
+        ret.guesses++;
+        size_t half = count / 2;
+        base = (base[half] < searchValue) ? base + half : base;
+        count -= half;
+    }
+
+    ret.guesses++;
+    size_t baseIndex = size_t(base - values.data());
+    size_t lowerBound = baseIndex + ((*base < searchValue) ? 1 : 0);
+    LowerBoundToResults(values.data(), values.size(), searchValue, lowerBound, baseIndex, ret);
+    return ret;
+}
+
+// K-ary search compares the search value against K evenly spaced separators at once using SIMD, which splits
+// the range into K+1 parts per step instead of 2. The number of separators less than the search value says which
+// part to continue in. When the range gets down to K values or fewer, they are scanned to find the lower bound.
+// Every separator read counts as a guess.
+
+// how many bits are set in a 4 bit SIMD compare mask
+static const size_t c_popCount4[16] = { 0, 1, 1, 2, 1, 2, 2, 3, 1, 2, 2, 3, 2, 3, 3, 4 };
+
+inline void KArySearch_Finish(const std::vector<size_t>& values, size_t searchValue, size_t minIndex, size_t maxIndex, TestResults& ret)
+{
+    size_t lowerBound = minIndex;
+    for (size_t index = minIndex; index < maxIndex; ++index)
+    {
+        ret.guesses++;
+        lowerBound += (values[index] < searchValue) ? 1 : 0;
+    }
+
+    // values[lowerBound] has always been read already, either by the scan or as a separator.
+    LowerBoundToResults(values.data(), values.size(), searchValue, lowerBound, lowerBound, ret);
+}
+
+TARGET_SSE42 TestResults TestList_KArySearch_SSE42(const std::vector<size_t>& values, size_t searchValue)
+{
+    // 4 separators per step, compared 2 at a time.
+    static const size_t c_numSeparators = 4;
+
+    TestResults ret;
+    ret.found = false;
+    ret.guesses = 0;
+
+    // the SIMD compare is signed, so flip the sign bit of both sides to make it an unsigned compare
+    const size_t* data = values.data();
+    const __m128i signBit = _mm_set1_epi64x((long long)0x8000000000000000ull);
+    const __m128i key = _mm_xor_si128(_mm_set1_epi64x((long long)searchValue), signBit);
+
+    // the lower bound is always in [minIndex, maxIndex]
+    size_t minIndex = 0;
+    size_t maxIndex = values.size();
+    while (maxIndex - minIndex > c_numSeparators)
+    {
+        ret.guesses += c_numSeparators;
+        size_t step = (maxIndex - minIndex) / (c_numSeparators + 1);
+        const size_t* separators = &data[minIndex + step];
+
+        __m128i a = _mm_xor_si128(_mm_set_epi64x((long long)separators[step], (long long)separators[0]), signBit);
+        __m128i b = _mm_xor_si128(_mm_set_epi64x((long long)separators[step * 3], (long long)separators[step * 2]), signBit);
+        int maskA = _mm_movemask_pd(_mm_castsi128_pd(_mm_cmpgt_epi64(key, a)));
+        int maskB = _mm_movemask_pd(_mm_castsi128_pd(_mm_cmpgt_epi64(key, b)));
+        size_t numLess = c_popCount4[maskA | (maskB << 2)];
+
+        // the separators are at minIndex + step * (i+1)
+        size_t newMin = numLess > 0 ? minIndex + step * numLess + 1 : minIndex;
+        maxIndex = numLess < c_numSeparators ? minIndex + step * (numLess + 1) : maxIndex;
+        minIndex = newMin;
+    }
+
+    KArySearch_Finish(values, searchValue, minIndex, maxIndex, ret);
+    return ret;
+}
+
+TARGET_AVX2 TestResults TestList_KArySearch_AVX2(const std::vector<size_t>& values, size_t searchValue)
+{
+    // 8 separators per step, compared 4 at a time.
+    static const size_t c_numSeparators = 8;
+
+    TestResults ret;
+    ret.found = false;
+    ret.guesses = 0;
+
+    // the SIMD compare is signed, so flip the sign bit of both sides to make it an unsigned compare
+    const size_t* data = values.data();
+    const __m256i signBit = _mm256_set1_epi64x((long long)0x8000000000000000ull);
+    const __m256i key = _mm256_xor_si256(_mm256_set1_epi64x((long long)searchValue), signBit);
+
+    // the lower bound is always in [minIndex, maxIndex]
+    size_t minIndex = 0;
+    size_t maxIndex = values.size();
+    while (maxIndex - minIndex > c_numSeparators)
+    {
+        ret.guesses += c_numSeparators;
+        size_t step = (maxIndex - minIndex) / (c_numSeparators + 1);
+        const size_t* separators = &data[minIndex + step];
+
+        __m256i a = _mm256_xor_si256(_mm256_set_epi64x((long long)separators[step * 3], (long long)separators[step * 2], (long long)separators[step], (long long)separators[0]), signBit);
+        __m256i b = _mm256_xor_si256(_mm256_set_epi64x((long long)separators[step * 7], (long long)separators[step * 6], (long long)separators[step * 5], (long long)separators[step * 4]), signBit);
+        int maskA = _mm256_movemask_pd(_mm256_castsi256_pd(_mm256_cmpgt_epi64(key, a)));
+        int maskB = _mm256_movemask_pd(_mm256_castsi256_pd(_mm256_cmpgt_epi64(key, b)));
+        size_t numLess = c_popCount4[maskA] + c_popCount4[maskB];
+
+        // the separators are at minIndex + step * (i+1)
+        size_t newMin = numLess > 0 ? minIndex + step * numLess + 1 : minIndex;
+        maxIndex = numLess < c_numSeparators ? minIndex + step * (numLess + 1) : maxIndex;
+        minIndex = newMin;
+    }
+
+    KArySearch_Finish(values, searchValue, minIndex, maxIndex, ret);
+    return ret;
+}
+
+TestResults TestList_KArySearch(const std::vector<size_t>& values, size_t searchValue)
+{
+    // use the widest SIMD the CPU has, falling back to the scalar branchless binary search
+    static const TestListFn fn =
+        GetCPUFeatures().avx2 ? TestList_KArySearch_AVX2 :
+        GetCPUFeatures().sse42 ? TestList_KArySearch_SSE42 :
+        TestList_BranchlessBinarySearch<std::vector<size_t>>;
+
+    return fn(values, searchValue);
+}
+
+// ------------------------ FIXED SIZE TEST FUNCTIONS ------------------------
+
+// Searches for lists with a size known at compile time. The branchless binary search becomes a fixed sequence of
+// compares and conditional moves, with no loop or bounds logic, and tiny lists are scanned with SIMD in one go.
+// The lists in the tests are sized at runtime, so TestList_FixedSize is a dispatcher that uses the list size to pick
+// which compile time size to run.
+
+static const size_t c_fixedSizeMaxScan = 16;  // lists of up to this many values are scanned with SIMD, instead of binary searched
+static const size_t c_fixedSizeMaxLog2 = 12;  // lists with fewer than 2^(this+1) values use an unrolled binary search. Bigger lists use the loop.
+
+// Narrows the lower bound down from N values to 1, starting at base, which points at a value < searchValue or at the
+// first value. The recursion unrolls at compile time. Each step multiplies the compare result by the step size instead
+// of using a ternary, since with a constant step size the compiler turns a ternary into a branch instead of a cmov.
+template <size_t N>
+struct FixedBranchlessLowerBound
+{
+    static const size_t c_numSteps = 1 + FixedBranchlessLowerBound<N - N / 2>::c_numSteps;
+
+    static const size_t* Search(const size_t* base, size_t searchValue)
+    {
+        base += size_t(base[N / 2] < searchValue) * (N / 2);
+        return FixedBranchlessLowerBound<N - N / 2>::Search(base, searchValue);
+    }
+};
+
+template <>
+struct FixedBranchlessLowerBound<1>
+{
+    static const size_t c_numSteps = 0;
+
+    static const size_t* Search(const size_t* base, size_t searchValue)
+    {
+        return base;
+    }
+};
+
+// P is the biggest power of 2 that is <= the list size. The first compare picks whether the lower bound is in the
+// first P values or the last P values, which overlap unless the list size is exactly 2P-1.
+template <size_t P>
+TestResults TestList_FixedBranchless(const std::vector<size_t>& values, size_t searchValue)
+{
+    TestResults ret;
+    ret.found = false;
+    ret.guesses = 1 + FixedBranchlessLowerBound<P>::c_numSteps + 1;
+
+    const size_t* data = values.data();
+    size_t count = values.size();
+    const size_t* base = data + size_t(data[P - 1] < searchValue) * (count - P);
+    base = FixedBranchlessLowerBound<P>::Search(base, searchValue);
+
+    size_t baseIndex = size_t(base - data);
+    size_t lowerBound = baseIndex + ((*base < searchValue) ? 1 : 0);
+    LowerBoundToResults(data, count, searchValue, lowerBound, baseIndex, ret);
+    return ret;
+}
+
+// The scans count how many of the N values are less than the search value, which is the lower bound.
+template <size_t N>
+size_t FixedScan(const size_t* data, size_t searchValue)
+{
+    size_t lowerBound = 0;
+    for (size_t index = 0; index < N; ++index)
+        lowerBound += (data[index] < searchValue) ? 1 : 0;
+    return lowerBound;
+}
+
+template <size_t N>
+TARGET_SSE42 size_t FixedScan_SSE42(const size_t* data, size_t searchValue)
+{
+    // the SIMD compare is signed, so flip the sign bit of both sides to make it an unsigned compare
+    const __m128i signBit = _mm_set1_epi64x((long long)0x8000000000000000ull);
+    const __m128i key = _mm_xor_si128(_mm_set1_epi64x((long long)searchValue), signBit);
+
+    size_t lowerBound = 0;
+    for (size_t index = 0; index + 2 <= N; index += 2)
+    {
+        __m128i a = _mm_xor_si128(_mm_loadu_si128((const __m128i*)&data[index]), signBit);
+        lowerBound += c_popCount4[_mm_movemask_pd(_mm_castsi128_pd(_mm_cmpgt_epi64(key, a)))];
+    }
+    for (size_t index = N & ~size_t(1); index < N; ++index)
+        lowerBound += (data[index] < searchValue) ? 1 : 0;
+    return lowerBound;
+}
+
+template <size_t N>
+TARGET_AVX2 size_t FixedScan_AVX2(const size_t* data, size_t searchValue)
+{
+    // the SIMD compare is signed, so flip the sign bit of both sides to make it an unsigned compare
+    const __m256i signBit = _mm256_set1_epi64x((long long)0x8000000000000000ull);
+    const __m256i key = _mm256_xor_si256(_mm256_set1_epi64x((long long)searchValue), signBit);
+
+    size_t lowerBound = 0;
+    for (size_t index = 0; index + 4 <= N; index += 4)
+    {
+        __m256i a = _mm256_xor_si256(_mm256_loadu_si256((const __m256i*)&data[index]), signBit);
+        lowerBound += c_popCount4[_mm256_movemask_pd(_mm256_castsi256_pd(_mm256_cmpgt_epi64(key, a)))];
+    }
+    for (size_t index = N & ~size_t(3); index < N; ++index)
+        lowerBound += (data[index] < searchValue) ? 1 : 0;
+    return lowerBound;
+}
+
+// Every value is read, so every value counts as a guess
+template <size_t N>
+TestResults TestList_FixedScan(const std::vector<size_t>& values, size_t searchValue)
+{
+    static const bool avx2 = GetCPUFeatures().avx2;
+    static const bool sse42 = GetCPUFeatures().sse42;
+
+    TestResults ret;
+    ret.found = false;
+    ret.guesses = N;
+
+    size_t lowerBound =
+        avx2 ? FixedScan_AVX2<N>(values.data(), searchValue) :
+        sse42 ? FixedScan_SSE42<N>(values.data(), searchValue) :
+        FixedScan<N>(values.data(), searchValue);
+
+    LowerBoundToResults(values.data(), values.size(), searchValue, lowerBound, lowerBound, ret);
+    return ret;
+}
+
+// indexed by list size
+static const TestListFn c_fixedScanFns[c_fixedSizeMaxScan + 1] =
+{
+    nullptr,
+    TestList_FixedScan<1>,
+    TestList_FixedScan<2>,
+    TestList_FixedScan<3>,
+    TestList_FixedScan<4>,
+    TestList_FixedScan<5>,
+    TestList_FixedScan<6>,
+    TestList_FixedScan<7>,
+    TestList_FixedScan<8>,
+    TestList_FixedScan<9>,
+    TestList_FixedScan<10>,
+    TestList_FixedScan<11>,
+    TestList_FixedScan<12>,
+    TestList_FixedScan<13>,
+    TestList_FixedScan<14>,
+    TestList_FixedScan<15>,
+    TestList_FixedScan<16>
+};
+
+// indexed by log2 of the biggest power of 2 <= the list size
+static const TestListFn c_fixedBranchlessFns[c_fixedSizeMaxLog2 + 1] =
+{
+    TestList_FixedBranchless<1>,
+    TestList_FixedBranchless<2>,
+    TestList_FixedBranchless<4>,
+    TestList_FixedBranchless<8>,
+    TestList_FixedBranchless<16>,
+    TestList_FixedBranchless<32>,
+    TestList_FixedBranchless<64>,
+    TestList_FixedBranchless<128>,
+    TestList_FixedBranchless<256>,
+    TestList_FixedBranchless<512>,
+    TestList_FixedBranchless<1024>,
+    TestList_FixedBranchless<2048>,
+    TestList_FixedBranchless<4096>
+};
+
+TestResults TestList_FixedSizeBranchless(const std::vector<size_t>& values, size_t searchValue)
+{
+    size_t log2 = 0;
+    while ((values.size() >> (log2 + 1)) != 0)
+        log2++;
+
+    if (log2 > c_fixedSizeMaxLog2)
+        return TestList_BranchlessBinarySearch(values, searchValue);
+    return c_fixedBranchlessFns[log2](values, searchValue);
+}
+
+// The size class dispatcher: SIMD scans for tiny lists, unrolled branchless binary search for the rest
+TestResults TestList_FixedSize(const std::vector<size_t>& values, size_t searchValue)
+{
+    if (values.size() <= c_fixedSizeMaxScan)
+        return c_fixedScanFns[values.size()](values, searchValue);
+    return TestList_FixedSizeBranchless(values, searchValue);
+}
+
+// ------------------------ LAYOUTS ------------------------
+
+// A layout rearranges the sorted list into a different order in memory, so that the values a search reads
+// are closer together and the top of the search tree stays in cache.
+// The layout search functions take the layout instead of the sorted list, but return the index in the sorted list.
+// Each layout starts with a small header, followed by the rearranged values, followed by the sorted list index of each of them.
+// Reading the sorted list index at the end of a search counts as a guess.
+
+// Eytzinger layout is a binary search tree stored breadth first like a binary heap: the children of k are 2k and 2k+1.
+// Layout: [count, node offset, padding, unused, values 1..count, sorted index 1..count]
+// The nodes are padded so that the unused node 0 starts on a cache line, which puts nodes 8k to 8k+7 in the same cache line.
+size_t MakeLayout_Eytzinger_Recursive(const std::vector<size_t>& values, size_t* keys, size_t sortedIndex, size_t k)
+{
+    // an in order traversal of the tree visits the sorted values in order
+    size_t count = values.size();
+    if (k > count)
+        return sortedIndex;
+    sortedIndex = MakeLayout_Eytzinger_Recursive(values, keys, sortedIndex, 2 * k);
+    keys[k] = values[sortedIndex];
+    keys[count + k] = sortedIndex;
+    sortedIndex++;
+    return MakeLayout_Eytzinger_Recursive(values, keys, sortedIndex, 2 * k + 1);
+}
+
+void MakeLayout_Eytzinger(const std::vector<size_t>& values, std::vector<size_t>& layout)
+{
+    size_t count = values.size();
+    layout.resize(2 + 64 / sizeof(size_t) + count * 2);
+
+    // find where the nodes need to start to be cache line aligned
+    size_t nodeOffset = 2;
+    while ((size_t(&layout[nodeOffset]) % 64) != 0)
+        nodeOffset++;
+
+    layout[0] = count;
+    layout[1] = nodeOffset;
+    MakeLayout_Eytzinger_Recursive(values, &layout[nodeOffset], 0, 1);
+}
+
+TestResults TestList_Eytzinger(const std::vector<size_t>& layout, size_t searchValue)
+{
+    TestResults ret;
+    ret.found = false;
+    ret.guesses = 0;
+
+    size_t count = layout[0];
+    const size_t* keys = &layout[layout[1]];
+
+    // go left if the value is >= the search value, else go right.
+    // The 8 great grandchildren of k are in one cache line, so prefetch them 3 levels ahead.
+    // Near the bottom they are past the end of the tree, so it prefetches the last node instead.
+    size_t k = 1;
+    while (k <= count)
+    {
+        Prefetch(keys + std::min(k * 8, count));
+        ret.guesses++;
+        k = 2 * k + ((keys[k] < searchValue) ? 1 : 0);
+    }
+
+    // the right turns taken since the last left turn are the trailing ones of k. Undoing them gives the last node
+    // where we went left, which is the lower bound. If we never went left, k becomes 0 and everything was < the search value.
+    k >>= CountTrailingZeros(~k) + 1;
+    if (k == 0)
+    {
+        ret.index = count - 1;
+        return ret;
+    }
+
+    ret.guesses++;
+    ret.found = keys[k] == searchValue;
+    ret.index = keys[count + k];
+    return ret;
+}
+
+// The static B-tree layout stores 8 values (a 64 byte cache line) per node, and each node has 9 children.
+// Like Eytzinger, it is implicit: the children of node k are k * 9 + i + 1. Reading a node counts as a single guess.
+// Slots past the end of the list are filled with ~0 and have a sorted index of count.
+// Layout: [count, node count, node offset, padding so the nodes are 64 byte aligned, nodes, sorted indices]
+static const size_t c_bTreeNodeSize = 64 / sizeof(size_t);
+
+size_t MakeLayout_BTree_Recursive(const std::vector<size_t>& values, size_t* keys, size_t* sortedIndices, size_t numNodes, size_t sortedIndex, size_t k)
+{
+    if (k >= numNodes)
+        return sortedIndex;
+
+    size_t count = values.size();
+    for (size_t i = 0; i < c_bTreeNodeSize; ++i)
+    {
+        sortedIndex = MakeLayout_BTree_Recursive(values, keys, sortedIndices, numNodes, sortedIndex, k * (c_bTreeNodeSize + 1) + i + 1);
+        keys[k * c_bTreeNodeSize + i] = sortedIndex < count ? values[sortedIndex] : ~size_t(0);
+        sortedIndices[k * c_bTreeNodeSize + i] = std::min(sortedIndex, count);
+        sortedIndex++;
+    }
+    return MakeLayout_BTree_Recursive(values, keys, sortedIndices, numNodes, sortedIndex, k * (c_bTreeNodeSize + 1) + c_bTreeNodeSize + 1);
+}
+
+void MakeLayout_BTree(const std::vector<size_t>& values, std::vector<size_t>& layout)
+{
+    size_t count = values.size();
+    size_t numNodes = (count + c_bTreeNodeSize - 1) / c_bTreeNodeSize;
+    layout.resize(3 + c_bTreeNodeSize + numNodes * c_bTreeNodeSize * 2);
+
+    // find where the nodes need to start to be cache line aligned
+    size_t nodeOffset = 3;
+    while ((size_t(&layout[nodeOffset]) % 64) != 0)
+        nodeOffset++;
+
+    layout[0] = count;
+    layout[1] = numNodes;
+    layout[2] = nodeOffset;
+    size_t* keys = &layout[nodeOffset];
+    MakeLayout_BTree_Recursive(values, keys, keys + numNodes * c_bTreeNodeSize, numNodes, 0, 0);
+}
+
+template <typename TLayout>
+TestResults TestList_BTree(const TLayout& layout, size_t searchValue)
+{
+    TestResults ret;
+    ret.found = false;
+    ret.guesses = 0;
+
+    size_t count = layout[0];
+    size_t numNodes = layout[1];
+    const size_t* keys = &layout[layout[2]];
+    const size_t* sortedIndices = keys + numNodes * c_bTreeNodeSize;
+
+    // the smallest value >= the search value seen on the way down is the lower bound
+    size_t lowerBoundSlot = ~size_t(0);
+    size_t k = 0;
+    while (k < numNodes)
+    {
+        ret.guesses++;
+        const size_t* node = &keys[k * c_bTreeNodeSize];
+        size_t i = 0;
+        for (size_t slot = 0; slot < c_bTreeNodeSize; ++slot)
+            i += (node[slot] < searchValue) ? 1 : 0;
+
+        if (i < c_bTreeNodeSize)
+            lowerBoundSlot = k * c_bTreeNodeSize + i;
+        k = k * (c_bTreeNodeSize + 1) + i + 1;
+    }
+
+    // everything was less than the search value
+    if (lowerBoundSlot == ~size_t(0))
+    {
+        ret.index = count - 1;
+        return ret;
+    }
+
+    ret.guesses++;
+    size_t sortedIndex = sortedIndices[lowerBoundSlot];
+    if (sortedIndex >= count)
+    {
+        ret.index = count - 1;
+        return ret;
+    }
+
+    ret.found = keys[lowerBoundSlot] == searchValue;
+    ret.index = sortedIndex;
+    return ret;
+}
+
+// The learned index generalizes line fit: instead of fitting one line between the end points and refitting after
+// every guess, it fits the whole list ahead of time with as few lines (segments) as it can, such that every segment
+// predicts the index of any value within c_learnedIndexMaxError. A search picks the segment, makes a prediction,
+// and binary searches the small window around the prediction.
+//
+// For every unique value v in the list, the segments are fit to these (value, index) points:
+//   (v, first index of v) - where searching for v needs to end up
+//   (v+1, last index of v + 1) - where searching for anything between v and the next value needs to end up
+// Both of those are lower bounds, and the lines are never decreasing, so the prediction for any search value that
+// falls between two points is also within the error bound.
+//
+// Segments are made greedily: a segment starts at a point, and keeps the range of slopes that would keep every point
+// added so far within the error bound. When a point would make that range empty, it starts a new segment.
+//
+// Layout: [count, segment count, segment first values, (segment first index, segment slope) pairs, sorted list]
+void MakeLayout_LearnedIndex(const std::vector<size_t>& values, std::vector<size_t>& layout)
+{
+    std::vector<size_t> segmentValues, segmentIndices;
+    std::vector<double> segmentSlopes;
+
+    double slopeMin = 0.0;
+    double slopeMax = 0.0;
+    auto AddPoint = [&](size_t value, size_t index)
+    {
+        if (!segmentValues.empty())
+        {
+            double run = double(value - segmentValues.back());
+            double rise = double(index) - double(segmentIndices.back());
+            double newSlopeMin = std::max(slopeMin, (rise - double(c_learnedIndexMaxError)) / run);
+            double newSlopeMax = std::min(slopeMax, (rise + double(c_learnedIndexMaxError)) / run);
+            if (newSlopeMin <= newSlopeMax)
+            {
+                slopeMin = newSlopeMin;
+                slopeMax = newSlopeMax;
+                return;
+            }
+
+            // this point doesn't fit, so finish the current segment
+            segmentSlopes.push_back(slopeMax == HUGE_VAL ? 0.0 : (slopeMin + slopeMax) * 0.5);
+        }
+
+        segmentValues.push_back(value);
+        segmentIndices.push_back(index);
+        slopeMin = 0.0;
+        slopeMax = HUGE_VAL;
+    };
+
+    size_t count = values.size();
+    size_t index = 0;
+    while (index < count)
+    {
+        size_t value = values[index];
+        size_t firstIndex = index;
+        while (index < count && values[index] == value)
+            index++;
+
+        AddPoint(value, firstIndex);
+        if (value != ~size_t(0) && (index == count || values[index] != value + 1))
+            AddPoint(value + 1, index);
+    }
+    segmentSlopes.push_back(slopeMax == HUGE_VAL ? 0.0 : (slopeMin + slopeMax) * 0.5);
+
+    size_t numSegments = segmentValues.size();
+    layout.resize(2 + numSegments * 3 + count);
+    layout[0] = count;
+    layout[1] = numSegments;
+    size_t* segmentValuesOut = &layout[2];
+    size_t* segmentsOut = segmentValuesOut + numSegments;
+    for (size_t segmentIndex = 0; segmentIndex < numSegments; ++segmentIndex)
+    {
+        segmentValuesOut[segmentIndex] = segmentValues[segmentIndex];
+        segmentsOut[segmentIndex * 2] = segmentIndices[segmentIndex];
+        memcpy(&segmentsOut[segmentIndex * 2 + 1], &segmentSlopes[segmentIndex], sizeof(double));
+    }
+    std::copy(values.begin(), values.end(), segmentsOut + numSegments * 2);
+}
+
+TestResults TestList_LearnedIndex(const std::vector<size_t>& layout, size_t searchValue)
+{
+    TestResults ret;
+    ret.found = false;
+    ret.guesses = 0;
+
+    size_t count = layout[0];
+    size_t numSegments = layout[1];
+    const size_t* segmentValues = &layout[2];
+    const size_t* segments = segmentValues + numSegments;
+    const size_t* values = segments + numSegments * 2;
+
+    // the first segment starts at the min value, so this is the same as the min check in line fit
+    if (searchValue < segmentValues[0])
+    {
+        ret.index = 0;
+        return ret;
+    }
+
+    // find the last segment that starts at or before the search value
+    const size_t* base = segmentValues;
+    size_t segmentCount = numSegments;
+    while (segmentCount > 1)
+    {
+        ret.guesses++;
+        size_t half = segmentCount / 2;
+        base = (base[half] <= searchValue) ? base + half : base;
+        segmentCount -= half;
+    }
+    size_t segmentIndex = size_t(base - segmentValues);
+
+    // predict where the value is, and clamp it to the range the segment covers
+    ret.guesses++;
+    size_t segmentStartIndex = segments[segmentIndex * 2];
+    double slope;
+    memcpy(&slope, &segments[segmentIndex * 2 + 1], sizeof(double));
+    size_t segmentEndIndex = (segmentIndex + 1 < numSegments) ? segments[segmentIndex * 2 + 2] : count;
+    double prediction = double(segmentStartIndex) + slope * double(searchValue - segmentValues[segmentIndex]);
+    size_t predictedIndex = (prediction < double(segmentEndIndex)) ? size_t(prediction) : segmentEndIndex;
+
+    // the lower bound is within the error bound of the prediction. One extra index on each side covers rounding.
+    size_t minIndex = (predictedIndex > segmentStartIndex + c_learnedIndexMaxError + 1) ? predictedIndex - c_learnedIndexMaxError - 1 : segmentStartIndex;
+    size_t maxIndex = std::min(predictedIndex + c_learnedIndexMaxError + 1, segmentEndIndex);
+
+    // binary search the window for the lower bound
+    size_t lastGuessIndex = ~size_t(0);
+    size_t windowCount = maxIndex - minIndex;
+    while (windowCount > 0)
+    {
+        ret.guesses++;
+        size_t half = windowCount / 2;
+        if (values[minIndex + half] < searchValue)
+        {
+            minIndex += half + 1;
+            windowCount -= half + 1;
+        }
+        else
+        {
+            lastGuessIndex = minIndex + half;
+            windowCount = half;
+        }
+    }
+
+    LowerBoundToResults(values, count, searchValue, minIndex, lastGuessIndex, ret);
+    return ret;
+}
+
+// ------------------------ BATCH TEST FUNCTIONS ------------------------
+
+// These do the same searches as the functions above, but work on many search values at once.
+// They keep c_batchInterleaveCount searches in flight and advance them round robin, one guess at a time.
+// When a search decides where it's going to look next, it prefetches that memory, and then moves on to the
+// other searches, so that by the time it comes back around, the value it wants to read is (hopefully) in cache.
+// That lets the memory latency of many searches overlap, instead of stalling on each read one after another.
+//
+// Each search is written as a state machine:
+//   Start() - begins a search. returns true if it was able to finish without reading memory (other than min and max).
+//   Step()  - reads values[guessIndex] and reacts to it. returns true if the search is finished.
+// The results (including guess counts) are identical to the single search versions.
+
+struct BinarySearchState
+{
+    TestResults result;
+    size_t guessIndex;
+    size_t minIndex;
+    size_t maxIndex;
+
+    bool Start(const std::vector<size_t>& values, size_t searchValue)
+    {
+        result.found = false;
+        result.guesses = 0;
+        minIndex = 0;
+        maxIndex = values.size() - 1;
+        guessIndex = (minIndex + maxIndex) / 2;
+        m_searchValue = searchValue;
+        return false;
+    }
+
+    bool Step(const std::vector<size_t>& values)
+    {
+        result.guesses++;
+        size_t guess = values[guessIndex];
+
+        // found it
+        if (guess == m_searchValue)
+        {
+            result.found = true;
+            result.index = guessIndex;
+            return true;
+        }
+        // if our guess was too low, it's the new min
+        else if (guess < m_searchValue)
+        {
+            minIndex = guessIndex + 1;
+        }
+        // if our guess was too high, it's the new max
+        else
+        {
+            // underflow prevention
+            if (guessIndex == 0)
+            {
+                result.index = guessIndex;
+                return true;
+            }
+            maxIndex = guessIndex - 1;
+        }
+
+        // fail case
+        if (minIndex > maxIndex)
+        {
+            result.index = guessIndex;
+            return true;
+        }
+
+        guessIndex = (minIndex + maxIndex) / 2;
+        return false;
+    }
+
+private:
+    size_t m_searchValue;
+};
+
+// HYBRID false is the line fit search, HYBRID true is the hybrid search which alternates line fit and binary search steps.
+template <bool HYBRID>
+struct LineFitSearchState
+{
+    TestResults result;
+    size_t guessIndex;
+    size_t minIndex;
+    size_t maxIndex;
+
+    bool Start(const std::vector<size_t>& values, size_t searchValue)
+    {
+        m_searchValue = searchValue;
+        minIndex = 0;
+        maxIndex = values.size() - 1;
+        m_min = values[minIndex];
+        m_max = values[maxIndex];
+
+        result.found = true;
+        result.guesses = 0;
+
+        // if we've already found the value, we are done
+        if (searchValue < m_min)
+        {
+            result.index = minIndex;
+            result.found = false;
+            return true;
+        }
+        if (searchValue > m_max)
+        {
+            result.index = maxIndex;
+            result.found = false;
+            return true;
+        }
+        if (searchValue == m_min)
+        {
+            result.index = minIndex;
+            return true;
+        }
+        if (searchValue == m_max)
+        {
+            result.index = maxIndex;
+            return true;
+        }
+
+        m_doBinaryStep = false;
+        MakeGuess();
+        return false;
+    }
+
+    bool Step(const std::vector<size_t>& values)
+    {
+        result.guesses++;
+        size_t guess = values[guessIndex];
+
+        // if we found it, return success
+        if (guess == m_searchValue)
+        {
+            result.index = guessIndex;
+            return true;
+        }
+
+        // if we were too low, this is our new minimum
+        if (guess < m_searchValue)
+        {
+            minIndex = guessIndex;
+            m_min = guess;
+        }
+        // else we were too high, this is our new maximum
+        else
+        {
+            maxIndex = guessIndex;
+            m_max = guess;
+        }
+
+        // if we run out of places to look, we didn't find it
+        if (minIndex + 1 >= maxIndex)
+        {
+            result.index = minIndex;
+            result.found = false;
+            return true;
+        }
+
+        // toggle what search mode we are using
+        if (HYBRID)
+            m_doBinaryStep = !m_doBinaryStep;
+
+        MakeGuess();
+        return false;
+    }
+
+private:
+    void MakeGuess()
+    {
+        // fit a line to the end points and use it to guess, or guess in the middle if doing a binary step
+        if (m_doBinaryStep)
+        {
+            guessIndex = (minIndex + maxIndex) / 2;
+        }
+        else
+        {
+            float m = (float(m_max) - float(m_min)) / float(maxIndex - minIndex);
+            float b = float(m_min) - m * float(minIndex);
+            guessIndex = size_t(0.5f + (float(m_searchValue) - b) / m);
+        }
+        guessIndex = Clamp(minIndex + 1, maxIndex - 1, guessIndex);
+    }
+
+    size_t m_searchValue;
+    size_t m_min;
+    size_t m_max;
+    bool m_doBinaryStep;
+};
+
+template <typename TSearchState>
+void TestListBatch_Interleaved(const std::vector<size_t>& values, const size_t* searchValues, size_t count, TestResults* results)
+{
+    TSearchState states[c_batchInterleaveCount];
+    size_t queryIndices[c_batchInterleaveCount];
+    bool busy[c_batchInterleaveCount];
+    size_t nextQuery = 0;
+
+    // start the next search that needs to read memory in this slot, and prefetch the first place it's going to look.
+    // searches that finish without reading memory are written out immediately.
+    auto StartNext = [&](size_t slot) -> bool
+    {
+        while (nextQuery < count)
+        {
+            size_t queryIndex = nextQuery++;
+            if (states[slot].Start(values, searchValues[queryIndex]))
+            {
+                results[queryIndex] = states[slot].result;
+                continue;
+            }
+            queryIndices[slot] = queryIndex;
+            Prefetch(&values[states[slot].guessIndex]);
+            return true;
+        }
+        return false;
+    };
+
+    size_t numBusy = 0;
+    for (size_t slot = 0; slot < c_batchInterleaveCount; ++slot)
+    {
+        busy[slot] = StartNext(slot);
+        if (busy[slot])
+            numBusy++;
+    }
+
+    while (numBusy > 0)
+    {
+        for (size_t slot = 0; slot < c_batchInterleaveCount; ++slot)
+        {
+            if (!busy[slot])
+                continue;
+
+            if (states[slot].Step(values))
+            {
+                results[queryIndices[slot]] = states[slot].result;
+                busy[slot] = StartNext(slot);
+                if (!busy[slot])
+                    numBusy--;
+            }
+            else
+            {
+                Prefetch(&values[states[slot].guessIndex]);
+            }
+        }
+    }
+}
+
+// When the search values are in sorted order, each search can start where the previous one ended, since the lower bound of
+// a value is never before the lower bound of a smaller value. This finds the lower bound of each search value by galloping
+// forward from the previous lower bound (looking 1, 2, 4, 8... values ahead) until it passes the search value, and then
+// binary searching the last gap. For many search values over a list, this is roughly one pass through the list, instead
+// of a full search per value.
+// If the search values aren't sorted already, the order to search them in is sorted first. Results are written in the
+// original order of the search values.
+void TestListBatch_SortedMerge(const std::vector<size_t>& values, const size_t* searchValues, size_t count, TestResults* results)
+{
+    std::vector<size_t> order;
+    bool sorted = std::is_sorted(searchValues, searchValues + count);
+    if (!sorted)
+    {
+        order.resize(count);
+        for (size_t index = 0; index < count; ++index)
+            order[index] = index;
+        std::sort(order.begin(), order.end(), [searchValues](size_t a, size_t b) { return searchValues[a] < searchValues[b]; });
+    }
+
+    size_t numValues = values.size();
+    size_t lowerBound = 0;
+    for (size_t orderIndex = 0; orderIndex < count; ++orderIndex)
+    {
+        size_t queryIndex = sorted ? orderIndex : order[orderIndex];
+        size_t searchValue = searchValues[queryIndex];
+
+        TestResults ret;
+        ret.found = false;
+        ret.guesses = 0;
+
+        // gallop forward. Everything before minIndex is known to be less than the search value.
+        size_t minIndex = lowerBound;
+        size_t step = 1;
+        size_t lastGuessIndex = ~size_t(0);
+        while (minIndex + step - 1 < numValues)
+        {
+            ret.guesses++;
+            if (values[minIndex + step - 1] >= searchValue)
+            {
+                lastGuessIndex = minIndex + step - 1;
+                break;
+            }
+            minIndex += step;
+            step *= 2;
+        }
+
+        // binary search what's left of the gap
+        size_t maxIndex = std::min(minIndex + step - 1, numValues);
+        while (minIndex < maxIndex)
+        {
+            ret.guesses++;
+            size_t guessIndex = (minIndex + maxIndex) / 2;
+            if (values[guessIndex] < searchValue)
+            {
+                minIndex = guessIndex + 1;
+            }
+            else
+            {
+                maxIndex = guessIndex;
+                lastGuessIndex = guessIndex;
+            }
+        }
+
+        lowerBound = minIndex;
+        LowerBoundToResults(values.data(), numValues, searchValue, lowerBound, lastGuessIndex, ret);
+        results[queryIndex] = ret;
+    }
+}
+
+// ------------------------ HINTED TEST FUNCTIONS ------------------------
+
+// These take a hint (a "finger") of where the search value probably is, like the index found by the last search when
+// searches are usually close to each other. They gallop out from the hint (looking 1, 2, 4, 8... values away) until
+// the search value is between two values they've read, and then do a normal search of just that range.
+// The range search gets an ArrayView of the range, so it's the same search function the other tests use.
+template <TestResults(*SEARCH)(const ArrayView<size_t>& values, size_t searchValue)>
+TestResults TestListHinted_Finger(const std::vector<size_t>& values, size_t searchValue, size_t hintIndex)
+{
+    TestResults ret;
+    ret.found = false;
+    ret.guesses = 1;
+
+    size_t lastIndex = values.size() - 1;
+    hintIndex = std::min(hintIndex, lastIndex);
+    size_t hint = values[hintIndex];
+    if (hint == searchValue)
+    {
+        ret.found = true;
+        ret.index = hintIndex;
+        return ret;
+    }
+
+    // find a range where values[minIndex] < searchValue < values[maxIndex], or that reaches the end of the list
+    size_t minIndex = hintIndex;
+    size_t maxIndex = hintIndex;
+    size_t step = 1;
+    if (hint < searchValue)
+    {
+        while (1)
+        {
+            if (maxIndex == lastIndex)
+            {
+                ret.index = lastIndex;
+                return ret;
+            }
+            minIndex = maxIndex;
+            maxIndex = std::min(maxIndex + step, lastIndex);
+            step *= 2;
+
+            ret.guesses++;
+            size_t value = values[maxIndex];
+            if (value == searchValue)
+            {
+                ret.found = true;
+                ret.index = maxIndex;
+                return ret;
+            }
+            if (value > searchValue)
+                break;
+        }
+    }
+    else
+    {
+        while (1)
+        {
+            if (minIndex == 0)
+            {
+                ret.index = 0;
+                return ret;
+            }
+            maxIndex = minIndex;
+            minIndex = minIndex > step ? minIndex - step : 0;
+            step *= 2;
+
+            ret.guesses++;
+            size_t value = values[minIndex];
+            if (value == searchValue)
+            {
+                ret.found = true;
+                ret.index = minIndex;
+                return ret;
+            }
+            if (value < searchValue)
+                break;
+        }
+    }
+
+    // search the range. Since the end points of the range bracket the search value, an index that's a valid place to
+    // insert the search value in the range, is also a valid place in the whole list.
+    TestResults rangeResult = SEARCH(ArrayView<size_t>(&values[minIndex], maxIndex - minIndex + 1), searchValue);
+    ret.found = rangeResult.found;
+    ret.index = minIndex + rangeResult.index;
+    ret.guesses += rangeResult.guesses;
+    return ret;
+}
+
+// Ignores the hint, to compare the hinted searches against
+template <TestResults(*SEARCH)(const std::vector<size_t>& values, size_t searchValue)>
+TestResults TestListHinted_IgnoreHint(const std::vector<size_t>& values, size_t searchValue, size_t hintIndex)
+{
+    return SEARCH(values, searchValue);
+}
+
+// Makes search values that wander randomly, each within c_randomWalkMaxStep of the one before it
+void MakeSearchValues_RandomWalk(std::vector<size_t>& searchValues, size_t count, size_t maxValue, std::mt19937& rng)
+{
+    std::uniform_int_distribution<size_t> startDist(0, maxValue);
+    std::uniform_int_distribution<int> stepDist(-int(c_randomWalkMaxStep), int(c_randomWalkMaxStep));
+
+    searchValues.resize(count);
+    size_t searchValue = startDist(rng);
+    for (size_t& v : searchValues)
+    {
+        int step = stepDist(rng);
+        if (step < 0)
+            searchValue = searchValue > size_t(-step) ? searchValue - size_t(-step) : 0;
+        else
+            searchValue = std::min(searchValue + size_t(step), maxValue);
+        v = searchValue;
+    }
+}
+
+// ------------------------ RANGE TEST FUNCTIONS ------------------------
+
+// The other searches find a copy of the search value, and with duplicates, different searches can find different copies.
+// These find the lower bound (the first value >= the search value) or upper bound (the first value > the search value)
+// exactly, which is what range queries and counts need. Each search keeps a bracket of two indices:
+// a, which is known to be before the bound, and b, which is known to be at or after it. Each guess between them replaces
+// one of them, until they are next to each other, and b is the bound.
+//
+// Like line fit, the first and last values of the list are read without counting them as guesses, since they could
+// reasonably be read in advance. The line fits use MulDivRound so they are exact, which means these are for integer keys.
+//
+// A range query [low, high] needs the lower bound of low and the upper bound of high. Searching for them independently
+// reads the same values twice at the start, when the brackets are wide. The shared range query uses every value read
+// while searching for the lower bound of low to also narrow the bracket for the upper bound of high, so the second
+// search starts where the first one left off.
+
+enum BoundGuess
+{
+    BoundGuess_Binary,
+    BoundGuess_LineFit,
+    BoundGuess_Hybrid,  // alternates line fit and binary steps, starting with line fit
+};
+
+template <typename TKey>
+struct BoundBracket
+{
+    size_t aIndex;  // known to be before the bound
+    TKey aValue;
+    size_t bIndex;  // known to be at or after the bound
+    TKey bValue;
+};
+
+// whether a value comes before the lower bound (UPPER = false) or the upper bound (UPPER = true) of a search value
+template <bool UPPER, typename TKey>
+inline bool IsBeforeBound(TKey value, TKey searchValue)
+{
+    return UPPER ? value <= searchValue : value < searchValue;
+}
+
+// Makes the starting bracket from the first and last value. Returns true if they are enough to know the bound already,
+// which they are for an empty list too, where the bound is 0.
+template <bool UPPER, typename TKey>
+bool InitBoundBracket(const TKey* values, size_t count, TKey searchValue, BoundBracket<TKey>& bracket, size_t& bound)
+{
+    if (count == 0 || !IsBeforeBound<UPPER>(values[0], searchValue))
+    {
+        bound = 0;
+        return true;
+    }
+    if (IsBeforeBound<UPPER>(values[count - 1], searchValue))
+    {
+        bound = count;
+        return true;
+    }
+    bracket.aIndex = 0;
+    bracket.aValue = values[0];
+    bracket.bIndex = count - 1;
+    bracket.bValue = values[count - 1];
+    return false;
+}
+
+// Updates a bracket with a value that was read, if it makes the bracket smaller
+template <bool UPPER, typename TKey>
+inline void NarrowBoundBracket(BoundBracket<TKey>& bracket, TKey searchValue, size_t index, TKey value)
+{
+    if (IsBeforeBound<UPPER>(value, searchValue))
+    {
+        if (index > bracket.aIndex)
+        {
+            bracket.aIndex = index;
+            bracket.aValue = value;
+        }
+    }
+    else if (index < bracket.bIndex)
+    {
+        bracket.bIndex = index;
+        bracket.bValue = value;
+    }
+}
+
+// Narrows the bracket down to the bound and returns it. onRead is called with the index and value of every guess.
+template <bool UPPER, BoundGuess GUESS, typename TKey, typename TOnRead>
+size_t SearchBound(const TKey* values, TKey searchValue, BoundBracket<TKey>& bracket, size_t& guesses, const TOnRead& onRead)
+{
+    // for integer keys, the first value > searchValue is the first value >= searchValue + 1, so the upper bound line
+    // fits aim for that. That keeps them from landing at the start of a run of duplicates of the search value.
+    // searchValue + 1 can't overflow, because the upper bound would have been the end of the list.
+    TKey target = UPPER ? TKey(searchValue + 1) : searchValue;
+
+    bool binaryStep = GUESS == BoundGuess_Binary;
+    while (bracket.aIndex + 1 < bracket.bIndex)
+    {
+        size_t guessIndex = binaryStep
+            ? bracket.aIndex + (bracket.bIndex - bracket.aIndex) / 2
+            : bracket.aIndex + size_t(MulDivRound(uint64_t(target - bracket.aValue), uint64_t(bracket.bIndex - bracket.aIndex), uint64_t(bracket.bValue - bracket.aValue)));
+        guessIndex = Clamp(bracket.aIndex + 1, bracket.bIndex - 1, guessIndex);
+
+        guesses++;
+        TKey guess = values[guessIndex];
+        onRead(guessIndex, guess);
+        if (IsBeforeBound<UPPER>(guess, searchValue))
+        {
+            bracket.aIndex = guessIndex;
+            bracket.aValue = guess;
+        }
+        else
+        {
+            bracket.bIndex = guessIndex;
+            bracket.bValue = guess;
+        }
+
+        if (GUESS == BoundGuess_Hybrid)
+            binaryStep = !binaryStep;
+    }
+    return bracket.bIndex;
+}
+
+struct IgnoreBoundRead
+{
+    template <typename TKey>
+    void operator()(size_t index, TKey value) const {}
+};
+
+// the index of the first value >= searchValue, which is values.size() if there isn't one
+template <BoundGuess GUESS, typename TValues>
+size_t LowerBound(const TValues& values, typename TValues::value_type searchValue, size_t& guesses)
+{
+    BoundBracket<typename TValues::value_type> bracket;
+    size_t bound;
+    if (InitBoundBracket<false>(values.data(), values.size(), searchValue, bracket, bound))
+        return bound;
+    return SearchBound<false, GUESS>(values.data(), searchValue, bracket, guesses, IgnoreBoundRead());
+}
+
+// the index of the first value > searchValue, which is values.size() if there isn't one
+template <BoundGuess GUESS, typename TValues>
+size_t UpperBound(const TValues& values, typename TValues::value_type searchValue, size_t& guesses)
+{
+    BoundBracket<typename TValues::value_type> bracket;
+    size_t bound;
+    if (InitBoundBracket<true>(values.data(), values.size(), searchValue, bracket, bound))
+        return bound;
+    return SearchBound<true, GUESS>(values.data(), searchValue, bracket, guesses, IgnoreBoundRead());
+}
+
+// [lower bound of low, upper bound of high), with the values read looking for the lower bound also narrowing the upper bound search.
+// low must be <= high.
+template <BoundGuess GUESS, typename TValues>
+RangeResults RangeSearch(const TValues& values, typename TValues::value_type low, typename TValues::value_type high)
+{
+    using TKey = typename TValues::value_type;
+
+    RangeResults ret;
+    ret.guesses = 0;
+
+    BoundBracket<TKey> lowBracket, highBracket;
+    bool highDone = InitBoundBracket<true>(values.data(), values.size(), high, highBracket, ret.upperBound);
+    if (InitBoundBracket<false>(values.data(), values.size(), low, lowBracket, ret.lowerBound))
+    {
+        // the lower bound is one of the ends, but the upper bound search can still start past it
+        if (!highDone && ret.lowerBound > 0)
+            NarrowBoundBracket<true>(highBracket, high, ret.lowerBound - 1, values[ret.lowerBound - 1]);
+    }
+    else if (!highDone)
+    {
+        ret.lowerBound = SearchBound<false, GUESS>(values.data(), low, lowBracket, ret.guesses,
+            [&](size_t index, TKey value) { NarrowBoundBracket<true>(highBracket, high, index, value); });
+    }
+    else
+    {
+        ret.lowerBound = SearchBound<false, GUESS>(values.data(), low, lowBracket, ret.guesses, IgnoreBoundRead());
+    }
+
+    if (!highDone)
+        ret.upperBound = SearchBound<true, GUESS>(values.data(), high, highBracket, ret.guesses, IgnoreBoundRead());
+    return ret;
+}
+
+// The range [low, high] found with two independent searches, to compare the shared range search against
+template <BoundGuess GUESS>
+RangeResults TestListRange_Independent(const std::vector<size_t>& values, size_t low, size_t high)
+{
+    RangeResults ret;
+    ret.guesses = 0;
+    ret.lowerBound = LowerBound<GUESS>(values, low, ret.guesses);
+    ret.upperBound = UpperBound<GUESS>(values, high, ret.guesses);
+    return ret;
+}
+
+template <BoundGuess GUESS>
+RangeResults TestListRange_Shared(const std::vector<size_t>& values, size_t low, size_t high)
+{
+    return RangeSearch<GUESS>(values, low, high);
+}
+
+// the range of copies of searchValue, like std::equal_range
+template <BoundGuess GUESS, typename TValues>
+RangeResults EqualRange(const TValues& values, typename TValues::value_type searchValue)
+{
+    return RangeSearch<GUESS>(values, searchValue, searchValue);
+}
+
+// how many copies of searchValue there are
+template <BoundGuess GUESS, typename TValues>
+size_t Count(const TValues& values, typename TValues::value_type searchValue, size_t& guesses)
+{
+    RangeResults range = EqualRange<GUESS>(values, searchValue);
+    guesses += range.guesses;
+    return range.upperBound - range.lowerBound;
+}
+
+// ------------------------ SEARCH VALUE FUNCTIONS ------------------------
+
+// Makes search values that are equally likely to be anything from 0 to maxValue
+void MakeSearchValues_Uniform(std::vector<size_t>& searchValues, size_t count, size_t maxValue, std::mt19937& rng)
+{
+    std::uniform_int_distribution<size_t> dist(0, maxValue);
+
+    searchValues.resize(count);
+    for (size_t& v : searchValues)
+        v = dist(rng);
+}
+
+// Makes zipf distributed search values, where the value of popularity rank k is searched for in proportion to 1/k^c_zipfExponent.
+// Ranks are drawn by inverting the CDF of the continuous power law, which is close to zipf and doesn't need a table per maxValue.
+// Ranks are then scattered over 0 to maxValue by multiplying by a prime, so the popular values aren't all at the start of the list.
+void MakeSearchValues_Zipf(std::vector<size_t>& searchValues, size_t count, size_t maxValue, std::mt19937& rng)
+{
+    std::uniform_real_distribution<double> dist(0.0, 1.0);
+    std::uniform_int_distribution<size_t> offsetDist(0, maxValue);
+
+    double oneMinusS = 1.0 - c_zipfExponent;
+    double maxRankPow = std::pow(double(maxValue) + 2.0, oneMinusS);
+    uint64_t numValues = uint64_t(maxValue) + 1;
+    uint64_t offset = offsetDist(rng);
+
+    searchValues.resize(count);
+    for (size_t& v : searchValues)
+    {
+        double x = std::pow((maxRankPow - 1.0) * dist(rng) + 1.0, 1.0 / oneMinusS);
+        uint64_t rank = std::min(uint64_t(x) - 1, numValues - 1);
+        v = size_t((rank * 2654435761ull + offset) % numValues);
+    }
+}
+
+// Makes search values that are mostly for a small set of hot values, picked at random from 0 to maxValue
+void MakeSearchValues_HotSet(std::vector<size_t>& searchValues, size_t count, size_t maxValue, std::mt19937& rng)
+{
+    std::uniform_int_distribution<size_t> dist(0, maxValue);
+    std::uniform_real_distribution<double> hotDist(0.0, 1.0);
+
+    std::vector<size_t> hotValues(c_hotSetSize);
+    for (size_t& v : hotValues)
+        v = dist(rng);
+    std::uniform_int_distribution<size_t> hotIndexDist(0, hotValues.size() - 1);
+
+    searchValues.resize(count);
+    for (size_t& v : searchValues)
+        v = hotDist(rng) < c_hotSetFraction ? hotValues[hotIndexDist(rng)] : dist(rng);
+}
+
+// ------------------------ PERF COUNTERS ------------------------
+
+// Hardware performance counters, to tell apart searches that are slow from cache misses vs branch mispredictions etc.
+// These use perf_event_open on linux. If a counter can't be opened (other OSes, virtual machines, perf_event_paranoid
+// settings), it's reported as unavailable and the rest of the perf test goes on as normal.
+
+enum PerfCounter
+{
+    PerfCounter_Cycles,
+    PerfCounter_Instructions,
+    PerfCounter_L1DMisses,
+    PerfCounter_LLCMisses,
+    PerfCounter_BranchMisses,
+    PerfCounter_DTLBMisses,
+
+    PerfCounter_Count
+};
+
+static const char* c_perfCounterNames[PerfCounter_Count] =
+{
+    "cycles",
+    "instructions",
+    "L1D misses",
+    "LLC misses",
+    "branch misses",
+    "dTLB misses",
+};
+
+struct PerfCounters
+{
+    PerfCounters()
+    {
+        for (int& fd : m_fds)
+            fd = -1;
+        for (double& value : m_values)
+            value = 0.0;
+
+        #if PERF_COUNTERS() && defined(__linux__)
+        static const uint32_t c_types[PerfCounter_Count] =
+        {
+            PERF_TYPE_HARDWARE,
+            PERF_TYPE_HARDWARE,
+            PERF_TYPE_HW_CACHE,
+            PERF_TYPE_HARDWARE,
+            PERF_TYPE_HARDWARE,
+            PERF_TYPE_HW_CACHE,
+        };
+        static const uint64_t c_configs[PerfCounter_Count] =
+        {
+            PERF_COUNT_HW_CPU_CYCLES,
+            PERF_COUNT_HW_INSTRUCTIONS,
+            PERF_COUNT_HW_CACHE_L1D | (PERF_COUNT_HW_CACHE_OP_READ << 8) | (PERF_COUNT_HW_CACHE_RESULT_MISS << 16),
+            PERF_COUNT_HW_CACHE_MISSES,
+            PERF_COUNT_HW_BRANCH_MISSES,
+            PERF_COUNT_HW_CACHE_DTLB | (PERF_COUNT_HW_CACHE_OP_READ << 8) | (PERF_COUNT_HW_CACHE_RESULT_MISS << 16),
+        };
+
+        for (size_t index = 0; index < PerfCounter_Count; ++index)
+        {
+            perf_event_attr attr;
+            memset(&attr, 0, sizeof(attr));
+            attr.size = sizeof(attr);
+            attr.type = c_types[index];
+            attr.config = c_configs[index];
+            attr.disabled = 1;
+            attr.exclude_kernel = 1;
+            attr.exclude_hv = 1;
+            attr.read_format = PERF_FORMAT_TOTAL_TIME_ENABLED | PERF_FORMAT_TOTAL_TIME_RUNNING;
+            m_fds[index] = int(syscall(SYS_perf_event_open, &attr, 0, -1, -1, 0));
+        }
+        #endif
+    }
+
+    ~PerfCounters()
+    {
+        #if defined(__linux__)
+        for (int fd : m_fds)
+        {
+            if (fd >= 0)
+                close(fd);
+        }
+        #endif
+    }
+
+    bool Available() const
+    {
+        for (int fd : m_fds)
+        {
+            if (fd >= 0)
+                return true;
+        }
+        return false;
+    }
+
+    void Start()
+    {
+        #if defined(__linux__)
+        for (int fd : m_fds)
+        {
+            if (fd < 0)
+                continue;
+            ioctl(fd, PERF_EVENT_IOC_RESET, 0);
+            ioctl(fd, PERF_EVENT_IOC_ENABLE, 0);
+        }
+        #endif
+    }
+
+    void Stop()
+    {
+        #if defined(__linux__)
+        for (size_t index = 0; index < PerfCounter_Count; ++index)
+        {
+            if (m_fds[index] < 0)
+                continue;
+            ioctl(m_fds[index], PERF_EVENT_IOC_DISABLE, 0);
+
+            // if there are more counters than the hardware has, the kernel time slices them, so scale up to the full run
+            uint64_t data[3] = { 0, 0, 0 }; // value, time enabled, time running
+            m_values[index] = 0.0;
+            if (read(m_fds[index], data, sizeof(data)) == sizeof(data) && data[2] > 0)
+                m_values[index] = double(data[0]) * double(data[1]) / double(data[2]);
+        }
+        #endif
+    }
+
+    // prints each counter divided by the number of searches done between Start() and Stop()
+    void PrintPerSearch(size_t numSearches) const
+    {
+        printf("    per search:");
+        for (size_t index = 0; index < PerfCounter_Count; ++index)
+        {
+            if (m_fds[index] >= 0)
+                printf(" %s %0.2f", c_perfCounterNames[index], m_values[index] / double(numSearches));
+            else
+                printf(" %s n/a", c_perfCounterNames[index]);
+        }
+        printf("\n");
+    }
+
+private:
+    int m_fds[PerfCounter_Count];
+    double m_values[PerfCounter_Count];
+};
+
+// ------------------------ KEY TYPE PERF TEST ------------------------
+
+// The perf test in main() calls the searches through function pointers, on size_t values.
+// This one instantiates the searches for each key type and calls them directly, so the compiler can inline
+// and specialize them into the timing loop. The lists are made as size_t values from an rng seeded with c_csvSeed,
+// and converted to each key type, so every key type searches the same values.
+
+// defined with main(), where the perf test uses it too
+template <typename TValues>
+void VerifyResults(const TValues& values, typename TValues::value_type searchValue, const TestResults& result, const char* list, const char* test);
+
+#define SEARCH_KERNEL(KERNEL, NAME, FN) \
+    struct KERNEL \
+    { \
+        static const char* Name() { return NAME; } \
+        template <typename TValues> \
+        static TestResults Search(const TValues& values, typename TValues::value_type searchValue) { return FN(values, searchValue); } \
+    };
+
+SEARCH_KERNEL(Kernel_LineFit, "Line Fit", TestList_LineFit)
+SEARCH_KERNEL(Kernel_BinarySearch, "Binary Search", TestList_BinarySearch)
+SEARCH_KERNEL(Kernel_HybridSearch, "Hybrid", TestList_HybridSearch)
+SEARCH_KERNEL(Kernel_AdaptiveSearch, "Adaptive", TestList_AdaptiveSearch)
+SEARCH_KERNEL(Kernel_BranchlessBinarySearch, "Branchless Binary Search", TestList_BranchlessBinarySearch)
+SEARCH_KERNEL(Kernel_LineFitInteger, "Line Fit Integer", TestList_LineFitInteger)
+SEARCH_KERNEL(Kernel_HybridSearchInteger, "Hybrid Integer", TestList_HybridSearchInteger)
+SEARCH_KERNEL(Kernel_BTree, "B-Tree", TestList_BTree)  // searches a layout made by MakeLayout_BTree, not the sorted list
+
+template <typename TKernel, typename TKey>
+void PerfTestKeyType_Search(const char* keyTypeName, const char* const* listNames, const std::vector<std::vector<TKey>>& lists, const std::vector<TKey>& searchValues)
+{
+    double timeTotal = 0.0;
+    size_t totalGuesses = 0;
+    for (size_t listIndex = 0; listIndex < lists.size(); ++listIndex)
+    {
+        const std::vector<TKey>& list = lists[listIndex];
+        ArrayView<TKey> values(list.data(), list.size());
+
+        std::chrono::high_resolution_clock::time_point start = std::chrono::high_resolution_clock::now();
+
+        for (TKey searchValue : searchValues)
+        {
+            TestResults ret = TKernel::Search(values, searchValue);
+            totalGuesses += ret.guesses;
+        }
+
+        std::chrono::high_resolution_clock::time_point end = std::chrono::high_resolution_clock::now();
+        timeTotal += std::chrono::duration_cast<std::chrono::duration<double>>(end - start).count();
+
+        #if VERIFY_RESULT()
+        for (TKey searchValue : searchValues)
+            VerifyResults(list, searchValue, TKernel::Search(values, searchValue), listNames[listIndex], TKernel::Name());
+        #endif
+    }
+
+    double timePerGuess = (timeTotal * 1000.0 * 1000.0 * 1000.0f) / double(totalGuesses);
+    printf("%s <%s> total : %f seconds  (%zu guesses = %f nanoseconds per guess)\n", TKernel::Name(), keyTypeName, timeTotal, totalGuesses, timePerGuess);
+}
+
+template <typename TKey>
+void PerfTestKeyType(const char* keyTypeName, const std::vector<size_t>& searchValues)
+{
+    // a new rng with the same seed for each key type, so they all get the same lists
+    std::mt19937 rng((unsigned int)c_csvSeed);
+
+    MakeListInfo makeFns[] =
+    {
+        {"Random", MakeList_Random<size_t>},
+        {"Linear", MakeList_Linear<size_t>},
+        {"Linear Outlier", MakeList_Linear_Outlier<size_t>},
+        {"Quadratic", MakeList_Quadratic<size_t>},
+        {"Cubic", MakeList_Cubic<size_t>},
+        {"Log", MakeList_Log<size_t>},
+    };
+
+    // the values are at most c_maxValue, which every key type holds exactly
+    std::vector<std::vector<TKey>> lists;
+    const char* listNames[countof(makeFns)];
+    lists.resize(countof(makeFns));
+    std::vector<size_t> values;
+    for (size_t makeIndex = 0; makeIndex < countof(makeFns); ++makeIndex)
+    {
+        makeFns[makeIndex].fn(values, c_maxNumValues, c_maxValue, rng);
+        lists[makeIndex].assign(values.begin(), values.end());
+        listNames[makeIndex] = makeFns[makeIndex].name;
+    }
+
+    std::vector<TKey> keySearchValues;
+    keySearchValues.reserve(searchValues.size());
+    for (size_t searchValue : searchValues)
+        keySearchValues.push_back(TKey(searchValue));
+
+    PerfTestKeyType_Search<Kernel_LineFit>(keyTypeName, listNames, lists, keySearchValues);
+    PerfTestKeyType_Search<Kernel_BinarySearch>(keyTypeName, listNames, lists, keySearchValues);
+    PerfTestKeyType_Search<Kernel_HybridSearch>(keyTypeName, listNames, lists, keySearchValues);
+    PerfTestKeyType_Search<Kernel_AdaptiveSearch>(keyTypeName, listNames, lists, keySearchValues);
+    PerfTestKeyType_Search<Kernel_BranchlessBinarySearch>(keyTypeName, listNames, lists, keySearchValues);
+    printf("\n");
+}
+
+// ------------------------ INTERPOLATION PRECISION TEST ------------------------
+
+// Compares the float and integer line fit and hybrid searches on lists big enough, with keys big enough, that a float
+// can't tell neighboring values apart. The kernels are called directly like in the key type perf test.
+
+template <typename TKernel>
+void InterpolationPrecisionTest_Search(const std::vector<size_t>& list, const std::vector<size_t>& searchValues)
+{
+    ArrayView<size_t> values(list.data(), list.size());
+    size_t guesses = 0;
+    size_t failures = 0;
+
+    std::chrono::high_resolution_clock::time_point start = std::chrono::high_resolution_clock::now();
+    for (size_t searchValue : searchValues)
+    {
+        TestResults ret = TKernel::Search(values, searchValue);
+        guesses += ret.guesses;
+
+        // VerifyResults is a linear search, which is too slow for lists this big, so just check the neighbors
+        #if VERIFY_RESULT()
+        if (ret.found ? list[ret.index] != searchValue :
+            (ret.index > 0 && list[ret.index - 1] > searchValue) || (ret.index + 1 < list.size() && list[ret.index + 1] < searchValue))
+            failures++;
+        #endif
+    }
+    std::chrono::high_resolution_clock::time_point end = std::chrono::high_resolution_clock::now();
+    double seconds = std::chrono::duration_cast<std::chrono::duration<double>>(end - start).count();
+
+    if (failures > 0)
+        printf("VERIFICATION FAILURE!! %zu wrong results! %s\n", failures, TKernel::Name());
+
+    printf("    %s : %0.2f guesses per search, %0.1f nanoseconds per search\n", TKernel::Name(),
+        double(guesses) / double(searchValues.size()), seconds * 1000.0 * 1000.0 * 1000.0 / double(searchValues.size()));
+}
+
+void InterpolationPrecisionTest()
+{
+    static std::random_device rd("dev/random");
+    static std::seed_seq fullSeed{ rd(), rd(), rd(), rd(), rd(), rd(), rd(), rd() };
+    static std::mt19937 rng(fullSeed);
+
+    MakeListInfo makeFns[] =
+    {
+        {"Random", MakeList_Random<size_t>},
+        {"Linear", MakeList_Linear<size_t>},
+        {"Quadratic", MakeList_Quadratic<size_t>},
+    };
+
+    std::vector<size_t> values, searchValues;
+    searchValues.resize(c_interpolationTestNumSearches);
+    printf("Float vs integer interpolation, with keys up to %zu:\n", c_interpolationTestMaxValue);
+    for (size_t sizeLog2 = c_interpolationTestMinLog2; sizeLog2 <= c_interpolationTestMaxLog2; sizeLog2 += 3)
+    {
+        size_t numValues = size_t(1) << sizeLog2;
+        std::uniform_int_distribution<size_t> dist(0, c_interpolationTestMaxValue);
+        for (size_t& v : searchValues)
+            v = dist(rng);
+
+        for (const MakeListInfo& makeFn : makeFns)
+        {
+            makeFn.fn(values, numValues, c_interpolationTestMaxValue, rng);
+
+            printf("  %s, 2^%zu values:\n", makeFn.name, sizeLog2);
+            InterpolationPrecisionTest_Search<Kernel_LineFit>(values, searchValues);
+            InterpolationPrecisionTest_Search<Kernel_LineFitInteger>(values, searchValues);
+            InterpolationPrecisionTest_Search<Kernel_HybridSearch>(values, searchValues);
+            InterpolationPrecisionTest_Search<Kernel_HybridSearchInteger>(values, searchValues);
+        }
+    }
+    printf("\n");
+}
+
+// ------------------------ THREAD POOL ------------------------
+
+// A pool of threads that runs ParallelFor() jobs. The calling thread works on the job too.
+// Each thread starts with an even share of the tasks, taking them from the front of its range. When a thread runs out,
+// it steals the back half of the remaining range of another thread, so threads that get cheap tasks help the ones that got expensive tasks.
+class WorkStealingPool
+{
+public:
+    explicit WorkStealingPool(size_t numThreads)
+        : m_numThreads(std::max(numThreads, size_t(1)))
+        , m_queues(new TaskQueue[m_numThreads])
+    {
+        for (size_t threadIndex = 1; threadIndex < m_numThreads; ++threadIndex)
+            m_threads.emplace_back([this, threadIndex]() { WorkerLoop(threadIndex); });
+    }
+
+    ~WorkStealingPool()
+    {
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            m_quit = true;
+        }
+        m_jobStarted.notify_all();
+        for (std::thread& t : m_threads)
+            t.join();
+    }
+
+    size_t NumThreads() const { return m_numThreads; }
+
+    // Calls fn(taskIndex) for every task index in [0, numTasks) and returns when they are all done.
+    void ParallelFor(size_t numTasks, const std::function<void(size_t taskIndex)>& fn)
+    {
+        for (size_t threadIndex = 0; threadIndex < m_numThreads; ++threadIndex)
+        {
+            std::lock_guard<std::mutex> lock(m_queues[threadIndex].mutex);
+            m_queues[threadIndex].begin = numTasks * threadIndex / m_numThreads;
+            m_queues[threadIndex].end = numTasks * (threadIndex + 1) / m_numThreads;
+        }
+
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            m_fn = &fn;
+            m_busyWorkers = m_numThreads - 1;
+            m_job++;
+        }
+        m_jobStarted.notify_all();
+
+        RunTasks(0);
+
+        std::unique_lock<std::mutex> lock(m_mutex);
+        m_jobFinished.wait(lock, [this]() { return m_busyWorkers == 0; });
+        m_fn = nullptr;
+    }
+
+private:
+    struct TaskQueue
+    {
+        std::mutex mutex;
+        size_t begin = 0;
+        size_t end = 0;
+    };
+
+    void WorkerLoop(size_t threadIndex)
+    {
+        size_t lastJob = 0;
+        while (1)
+        {
+            {
+                std::unique_lock<std::mutex> lock(m_mutex);
+                m_jobStarted.wait(lock, [this, lastJob]() { return m_quit || m_job != lastJob; });
+                if (m_quit)
+                    return;
+                lastJob = m_job;
+            }
+
+            RunTasks(threadIndex);
+
+            {
+                std::lock_guard<std::mutex> lock(m_mutex);
+                m_busyWorkers--;
+            }
+            m_jobFinished.notify_one();
+        }
+    }
+
+    void RunTasks(size_t threadIndex)
+    {
+        size_t taskIndex;
+        while (PopTask(threadIndex, taskIndex) || StealTask(threadIndex, taskIndex))
+            (*m_fn)(taskIndex);
+    }
+
+    bool PopTask(size_t threadIndex, size_t& taskIndex)
+    {
+        TaskQueue& queue = m_queues[threadIndex];
+        std::lock_guard<std::mutex> lock(queue.mutex);
+        if (queue.begin >= queue.end)
+            return false;
+        taskIndex = queue.begin++;
+        return true;
+    }
+
+    // Takes the back half of another thread's tasks. One of them is returned, and the rest go into this thread's queue.
+    bool StealTask(size_t threadIndex, size_t& taskIndex)
+    {
+        for (size_t offset = 1; offset < m_numThreads; ++offset)
+        {
+            size_t stolenBegin, stolenEnd;
+            {
+                TaskQueue& victim = m_queues[(threadIndex + offset) % m_numThreads];
+                std::lock_guard<std::mutex> lock(victim.mutex);
+                if (victim.begin >= victim.end)
+                    continue;
+                stolenBegin = victim.begin + (victim.end - victim.begin) / 2;
+                stolenEnd = victim.end;
+                victim.end = stolenBegin;
+            }
+
+            // this thread's queue is empty, and only this thread ever adds to it, so there's nothing to lose by overwriting it
+            taskIndex = stolenBegin;
+            TaskQueue& queue = m_queues[threadIndex];
+            std::lock_guard<std::mutex> lock(queue.mutex);
+            queue.begin = stolenBegin + 1;
+            queue.end = stolenEnd;
+            return true;
+        }
+        return false;
+    }
+
+    size_t m_numThreads;
+    std::unique_ptr<TaskQueue[]> m_queues;
+    std::vector<std::thread> m_threads;
+
+    std::mutex m_mutex;
+    std::condition_variable m_jobStarted;
+    std::condition_variable m_jobFinished;
+    const std::function<void(size_t)>* m_fn = nullptr;
+    size_t m_job = 0;
+    size_t m_busyWorkers = 0;
+    bool m_quit = false;
+};
+
+// ------------------------ DATASET GENERATORS ------------------------
+
+// Generators for lists shaped like real data. They write the values in sorted order as they go, instead of making
+// random values and sorting them, so they are O(N), and big lists are split up over threads.
+//
+// A list is made from spacings. Each value gets a positive spacing, and its position is the sum of the spacings up to
+// the middle of its own, divided by the sum of all of them. That makes sorted positions in (0, 1), which the inverse
+// CDF of a distribution turns into values. When the spacings are exponentially distributed, the positions are the
+// same as sorted uniform random numbers, so the values are the same as sorted random samples of the distribution.
+//
+// The list is made in chunks of c_generatorChunkSize values, each with its own random number generator seeded from the
+// list's seed and the chunk index. The first pass sums the spacings of each chunk, and the second pass makes the same
+// spacings again, starting from the sum of the chunks before it. The values only depend on the seed, and not on how
+// many threads made them.
+
+// The pool big lists are made on. Lists of one chunk are made on the calling thread, so the csv sweep's own threads
+// can make lists without waiting on each other for this pool.
+WorkStealingPool& GeneratorPool()
+{
+    static WorkStealingPool pool(std::thread::hardware_concurrency());
+    return pool;
+}
+
+// The list functions take the rng the tests use, and take the seed for a list from it
+uint64_t MakeGeneratorSeed(std::mt19937& rng)
+{
+    uint64_t high = rng();
+    return (high << 32) | rng();
+}
+
+std::mt19937_64 MakeChunkRng(uint64_t seed, size_t chunkIndex)
+{
+    std::seed_seq seq{ uint32_t(seed), uint32_t(seed >> 32), uint32_t(chunkIndex), uint32_t(uint64_t(chunkIndex) >> 32) };
+    return std::mt19937_64(seq);
+}
+
+// spacing(rng, index) returns the spacing of the value at index, which can't be negative.
+// inverseCDF(position) returns the value at a position in (0, 1). It is clamped to [0, maxValue].
+template <typename TKey, typename TSpacing, typename TInverseCDF>
+void MakeListFromSpacings(std::vector<TKey>& values, size_t count, size_t maxValue, uint64_t seed, const TSpacing& spacing, const TInverseCDF& inverseCDF)
+{
+    values.resize(count);
+    size_t numChunks = (count + c_generatorChunkSize - 1) / c_generatorChunkSize;
+    if (numChunks == 0)
+        return;
+
+    auto forEachChunk = [numChunks](const std::function<void(size_t chunkIndex)>& fn)
+    {
+        if (numChunks > 1)
+        {
+            GeneratorPool().ParallelFor(numChunks, fn);
+        }
+        else
+        {
+            for (size_t chunkIndex = 0; chunkIndex < numChunks; ++chunkIndex)
+                fn(chunkIndex);
+        }
+    };
+
+    // chunkSums[i] is the sum of the spacings before chunk i
+    std::vector<double> chunkSums(numChunks + 1, 0.0);
+    forEachChunk([&](size_t chunkIndex)
+    {
+        std::mt19937_64 rng = MakeChunkRng(seed, chunkIndex);
+        size_t end = std::min(count, (chunkIndex + 1) * c_generatorChunkSize);
+        double sum = 0.0;
+        for (size_t index = chunkIndex * c_generatorChunkSize; index < end; ++index)
+            sum += spacing(rng, index);
+        chunkSums[chunkIndex + 1] = sum;
+    });
+    for (size_t chunkIndex = 0; chunkIndex < numChunks; ++chunkIndex)
+        chunkSums[chunkIndex + 1] += chunkSums[chunkIndex];
+
+    // the spacings could all be 0 in a tiny list
+    double total = chunkSums[numChunks] > 0.0 ? chunkSums[numChunks] : 1.0;
+    double maxPosition = std::nextafter(1.0, 0.0);
+    forEachChunk([&](size_t chunkIndex)
+    {
+        std::mt19937_64 rng = MakeChunkRng(seed, chunkIndex);
+        size_t begin = chunkIndex * c_generatorChunkSize;
+        size_t end = std::min(count, begin + c_generatorChunkSize);
+        double sum = chunkSums[chunkIndex];
+        TKey lastValue = TKey(0);
+        for (size_t index = begin; index < end; ++index)
+        {
+            double s = spacing(rng, index);
+            double position = std::min((sum + s * 0.5) / total, maxPosition);
+            sum += s;
+
+            // the inverse CDFs round, so they could come out a hair lower than the value before
+            double value = std::min(std::max(inverseCDF(position), 0.0), double(maxValue));
+            lastValue = std::max(TKey(value), lastValue);
+            values[index] = lastValue;
+        }
+    });
+
+    // the sums of the chunks round differently than the sums within them, so the same can happen where chunks meet
+    for (size_t chunkIndex = 1; chunkIndex < numChunks; ++chunkIndex)
+    {
+        for (size_t index = chunkIndex * c_generatorChunkSize; index < count && values[index] < values[index - 1]; ++index)
+            values[index] = values[index - 1];
+    }
+}
+
+// A random double in [0, 1). The std distributions are slower, since they work for any rng.
+inline double RandomUnitDouble(std::mt19937_64& rng)
+{
+    return double(rng() >> 11) * (1.0 / 9007199254740992.0);
+}
+
+// A random double from the exponential distribution with a mean of 1
+inline double RandomExponential(std::mt19937_64& rng)
+{
+    return -log(1.0 - RandomUnitDouble(rng));
+}
+
+double ExponentialSpacing(std::mt19937_64& rng, size_t index)
+{
+    return RandomExponential(rng);
+}
+
+// Acklam's rational approximation of the inverse of the standard normal CDF. The relative error is under 1.2e-9.
+double InverseNormalCDF(double p)
+{
+    static const double a[] = { -3.969683028665376e+01, 2.209460984245205e+02, -2.759285104469687e+02, 1.383577518672690e+02, -3.066479806614716e+01, 2.506628277459239e+00 };
+    static const double b[] = { -5.447609879822406e+01, 1.615858368580409e+02, -1.556989798598866e+02, 6.680131188771972e+01, -1.328068155288572e+01 };
+    static const double c[] = { -7.784894002430293e-03, -3.223964580411365e-01, -2.400758277161838e+00, -2.549732539343734e+00, 4.374664141464968e+00, 2.938163982698783e+00 };
+    static const double d[] = { 7.784695709041462e-03, 3.224671290700398e-01, 2.445134137142996e+00, 3.754408661907416e+00 };
+    static const double pLow = 0.02425;
+
+    if (p < pLow)
+    {
+        double q = sqrt(-2.0 * log(p));
+        return (((((c[0] * q + c[1]) * q + c[2]) * q + c[3]) * q + c[4]) * q + c[5]) / ((((d[0] * q + d[1]) * q + d[2]) * q + d[3]) * q + 1.0);
+    }
+    if (p > 1.0 - pLow)
+    {
+        double q = sqrt(-2.0 * log(1.0 - p));
+        return -(((((c[0] * q + c[1]) * q + c[2]) * q + c[3]) * q + c[4]) * q + c[5]) / ((((d[0] * q + d[1]) * q + d[2]) * q + d[3]) * q + 1.0);
+    }
+    double q = p - 0.5;
+    double r = q * q;
+    return (((((a[0] * r + a[1]) * r + a[2]) * r + a[3]) * r + a[4]) * r + a[5]) * q / (((((b[0] * r + b[1]) * r + b[2]) * r + b[3]) * r + b[4]) * r + 1.0);
+}
+
+// Values whose log is normally distributed, like file sizes and prices. They bunch up at the low end with a long tail.
+// They are scaled so the value 1/count from the top is maxValue, and the few above that are clamped to it.
+template <typename TKey>
+void MakeList_Lognormal(std::vector<TKey>& values, size_t count, size_t maxValue, std::mt19937& rng)
+{
+    double scale = double(maxValue) / exp(c_lognormalSigma * InverseNormalCDF(1.0 - 1.0 / double(count + 1)));
+    MakeListFromSpacings(values, count, maxValue, MakeGeneratorSeed(rng), ExponentialSpacing,
+        [scale](double position) { return scale * exp(c_lognormalSigma * InverseNormalCDF(position)); });
+}
+
+// Values where value k shows up in proportion to 1/(k+1)^c_zipfListExponent, like word and product ids ranked by
+// popularity. Most of the list is a few small values repeated. The inverse CDF is of the continuous power law.
+template <typename TKey>
+void MakeList_Zipf(std::vector<TKey>& values, size_t count, size_t maxValue, std::mt19937& rng)
+{
+    double top = double(maxValue) + 2.0;
+    double power = 1.0 - c_zipfListExponent;
+    double topPowered = pow(top, power);
+    MakeListFromSpacings(values, count, maxValue, MakeGeneratorSeed(rng), ExponentialSpacing,
+        [top, power, topPowered](double position)
+        {
+            if (std::abs(power) < 1e-9)
+                return pow(top, position) - 1.0;
+            return pow(1.0 + position * (topPowered - 1.0), 1.0 / power) - 1.0;
+        });
+}
+
+// Values in c_clusterCount clusters of different widths and sizes, with empty gaps between them, like keys from
+// several sources that each have their own range. The values in a cluster are uniform.
+template <typename TKey>
+void MakeList_Clustered(std::vector<TKey>& values, size_t count, size_t maxValue, std::mt19937& rng)
+{
+    uint64_t seed = MakeGeneratorSeed(rng);
+
+    // cluster i is [edges[i*2], edges[i*2+1]], and is weights[i+1] - weights[i] of the list
+    std::mt19937_64 clusterRng = MakeChunkRng(seed, ~size_t(0));
+    std::uniform_real_distribution<double> edgeDist(0.0, double(maxValue));
+    std::exponential_distribution<double> weightDist(1.0);
+    std::vector<double> edges(c_clusterCount * 2);
+    std::vector<double> weights(c_clusterCount + 1, 0.0);
+    for (double& edge : edges)
+        edge = edgeDist(clusterRng);
+    std::sort(edges.begin(), edges.end());
+    for (size_t clusterIndex = 0; clusterIndex < c_clusterCount; ++clusterIndex)
+        weights[clusterIndex + 1] = weights[clusterIndex] + weightDist(clusterRng);
+    for (double& weight : weights)
+        weight /= weights[c_clusterCount];
+
+    MakeListFromSpacings(values, count, maxValue, seed, ExponentialSpacing,
+        [&edges, &weights](double position)
+        {
+            size_t clusterIndex = std::upper_bound(weights.begin() + 1, weights.end() - 1, position) - (weights.begin() + 1);
+            double fraction = (position - weights[clusterIndex]) / (weights[clusterIndex + 1] - weights[clusterIndex]);
+            return edges[clusterIndex * 2] + fraction * (edges[clusterIndex * 2 + 1] - edges[clusterIndex * 2]);
+        });
+}
+
+// Timestamps of events that arrive at random, with a gap now and then where nothing arrived, like logs from a service
+// that goes down sometimes. A c_timestampGapChance of the spacings are c_timestampGapLength times longer on average.
+template <typename TKey>
+void MakeList_Timestamps(std::vector<TKey>& values, size_t count, size_t maxValue, std::mt19937& rng)
+{
+    MakeListFromSpacings(values, count, maxValue, MakeGeneratorSeed(rng),
+        [](std::mt19937_64& rng, size_t index)
+        {
+            double spacing = ExponentialSpacing(rng, index);
+            if (RandomUnitDouble(rng) < c_timestampGapChance)
+                spacing *= c_timestampGapLength;
+            return spacing;
+        },
+        [maxValue](double position) { return position * double(maxValue); });
+}
+
+// Values that count up by 1, like auto incremented ids, with a c_outlierFraction of them spread out above, up to
+// maxValue. If maxValue is less than count, the dense values count up by less than 1 and repeat.
+template <typename TKey>
+void MakeList_DenseOutliers(std::vector<TKey>& values, size_t count, size_t maxValue, std::mt19937& rng)
+{
+    size_t numOutliers = std::min(count, std::max(size_t(1), size_t(double(count) * c_outlierFraction)));
+    size_t numDense = count - numOutliers;
+    double outlierSpacing = std::max(1.0, (double(maxValue) - double(numDense)) / double(numOutliers));
+    MakeListFromSpacings(values, count, maxValue, MakeGeneratorSeed(rng),
+        [numDense, outlierSpacing](std::mt19937_64& rng, size_t index)
+        {
+            if (index < numDense)
+                return 1.0;
+            return ExponentialSpacing(rng, index) * outlierSpacing;
+        },
+        [maxValue](double position) { return position * double(maxValue); });
+}
+
+// Times making big lists with each list function, and checks they come out sorted
+void GeneratorTest(const MakeListInfo* makeFns, size_t numMakeFns)
+{
+    static std::random_device rd("dev/random");
+    static std::seed_seq fullSeed{ rd(), rd(), rd(), rd(), rd(), rd(), rd(), rd() };
+    static std::mt19937 rng(fullSeed);
+
+    size_t maxValue = c_generatorTestNumValues * 2;
+    std::vector<size_t> values;
+    printf("Making lists of %zu values, on %zu threads:\n", c_generatorTestNumValues, GeneratorPool().NumThreads());
+    for (size_t makeIndex = 0; makeIndex < numMakeFns; ++makeIndex)
+    {
+        std::chrono::high_resolution_clock::time_point start = std::chrono::high_resolution_clock::now();
+        makeFns[makeIndex].fn(values, c_generatorTestNumValues, maxValue, rng);
+        std::chrono::high_resolution_clock::time_point end = std::chrono::high_resolution_clock::now();
+        double seconds = std::chrono::duration_cast<std::chrono::duration<double>>(end - start).count();
+
+        if (values.size() != c_generatorTestNumValues || !std::is_sorted(values.begin(), values.end()))
+            printf("VERIFICATION FAILURE!! %s didn't make a sorted list of %zu values!\n", makeFns[makeIndex].name, c_generatorTestNumValues);
+
+        size_t numDifferent = values.empty() ? 0 : 1;
+        for (size_t index = 1; index < values.size(); ++index)
+            numDifferent += values[index] != values[index - 1] ? 1 : 0;
+
+        printf("  %s : %f seconds (%0.1f million values per second), %zu different values\n", makeFns[makeIndex].name, seconds,
+            double(values.size()) / (seconds * 1000.0 * 1000.0), numDifferent);
+    }
+    printf("\n");
+}
+
+// ------------------------ PARALLEL TEST FUNCTIONS ------------------------
+
+// Splits the search values into chunks of c_parallelSearchChunkSize and searches them on all the threads of the pool.
+// The results are written in the same order as the search values.
+void TestListParallel(WorkStealingPool& pool, TestListFn fn, const std::vector<size_t>& values, const size_t* searchValues, size_t count, TestResults* results)
+{
+    size_t numChunks = (count + c_parallelSearchChunkSize - 1) / c_parallelSearchChunkSize;
+    pool.ParallelFor(numChunks,
+        [&](size_t chunkIndex)
+        {
+            size_t begin = chunkIndex * c_parallelSearchChunkSize;
+            size_t end = std::min(begin + c_parallelSearchChunkSize, count);
+            for (size_t searchIndex = begin; searchIndex < end; ++searchIndex)
+                results[searchIndex] = fn(values, searchValues[searchIndex]);
+        }
+    );
+}
+
+// Times every search on a list too big for the cache, from 1 thread up to as many threads as there are cores,
+// to show which searches keep scaling once memory bandwidth runs out.
+void ParallelTest(const TestListInfo* testFns, size_t numTestFns)
+{
+    static std::random_device rd("dev/random");
+    static std::seed_seq fullSeed{ rd(), rd(), rd(), rd(), rd(), rd(), rd(), rd() };
+    static std::mt19937 rng(fullSeed);
+
+    size_t maxValue = c_parallelTestNumValues * 2;
+    std::vector<size_t> values, layout, searchValues;
+    MakeList_Random(values, c_parallelTestNumValues, maxValue, rng);
+
+    searchValues.resize(c_parallelTestNumSearches);
+    std::uniform_int_distribution<size_t> dist(0, maxValue);
+    for (size_t& v : searchValues)
+        v = dist(rng);
+
+    std::vector<TestResults> results;
+    results.resize(c_parallelTestNumSearches);
+
+    // thread counts double from 1 up to the number of cores
+    std::vector<size_t> threadCounts;
+    size_t maxThreads = std::max(size_t(std::thread::hardware_concurrency()), size_t(1));
+    for (size_t numThreads = 1; numThreads < maxThreads; numThreads *= 2)
+        threadCounts.push_back(numThreads);
+    threadCounts.push_back(maxThreads);
+
+    printf("Multithreaded searches of a random list of %zu values:\n", c_parallelTestNumValues);
+    for (size_t testIndex = 0; testIndex < numTestFns; ++testIndex)
+    {
+        // linear search is O(n), which is far too slow for a list this size
+        if (testFns[testIndex].fn == TestList_LinearSearch<std::vector<size_t>>)
+            continue;
+
+        if (testFns[testIndex].layoutFn)
+            testFns[testIndex].layoutFn(values, layout);
+        const std::vector<size_t>& searchList = testFns[testIndex].layoutFn ? layout : values;
+
+        double singleThreadRate = 0.0;
+        printf("  %s :", testFns[testIndex].name);
+        for (size_t numThreads : threadCounts)
+        {
+            WorkStealingPool pool(numThreads);
+
+            std::chrono::high_resolution_clock::time_point start = std::chrono::high_resolution_clock::now();
+            TestListParallel(pool, testFns[testIndex].fn, searchList, searchValues.data(), searchValues.size(), results.data());
+            std::chrono::high_resolution_clock::time_point end = std::chrono::high_resolution_clock::now();
+
+            double seconds = std::chrono::duration_cast<std::chrono::duration<double>>(end - start).count();
+            double rate = double(searchValues.size()) / seconds;
+            if (numThreads == 1)
+                singleThreadRate = rate;
+            printf(" %zu threads %0.2f M searches/s (%0.2fx)", numThreads, rate / 1000000.0, rate / singleThreadRate);
+
+            // the searches are deterministic, so every result has to be the same as searching on this thread
+            #if VERIFY_RESULT()
+            size_t failures = 0;
+            for (size_t searchIndex = 0; searchIndex < searchValues.size(); ++searchIndex)
+            {
+                TestResults expected = testFns[testIndex].fn(searchList, searchValues[searchIndex]);
+                const TestResults& ret = results[searchIndex];
+                if (ret.found != expected.found || ret.index != expected.index || ret.guesses != expected.guesses)
+                    failures++;
+            }
+            if (failures > 0)
+                printf("\nVERIFICATION FAILURE!! %zu wrong results on %zu threads! %s\n", failures, numThreads, testFns[testIndex].name);
+            #endif
+        }
+        printf("\n");
+    }
+    printf("\n");
+}
+
+// ------------------------ BENCHMARK HARNESS ------------------------
+
+// The perf test times all the searches together, which gives an average and nothing else. This times each search on
+// its own with the cycle counter, into a histogram, to get the tail latencies. The searches are done c_benchmarkWarmupRuns
+// times untimed first, then timed c_benchmarkRepetitions times. The means of the repetitions give a confidence interval
+// of the mean, which is used to tell whether a search is really faster or slower than binary search, or just noise.
+//
+// With a warm cache, the list stays in cache from one search to the next, like in the perf test. With a cold cache,
+// the list (or layout) is flushed from every level of cache before each search, outside of the timed part.
+
+inline uint64_t ReadCycles()
+{
+    _mm_lfence();
+    uint64_t ret = __rdtsc();
+    _mm_lfence();
+    return ret;
+}
+
+// how many cycle counter ticks there are per nanosecond, measured once against the clock
+double CyclesPerNanosecond()
+{
+    static double cyclesPerNanosecond = 0.0;
+    if (cyclesPerNanosecond == 0.0)
+    {
+        std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+        uint64_t startCycles = ReadCycles();
+        std::chrono::steady_clock::time_point end;
+        do
+        {
+            end = std::chrono::steady_clock::now();
+        }
+        while (std::chrono::duration_cast<std::chrono::milliseconds>(end - start).count() < 50);
+        uint64_t endCycles = ReadCycles();
+        double nanoseconds = double(std::chrono::duration_cast<std::chrono::nanoseconds>(end - start).count());
+        cyclesPerNanosecond = double(endCycles - startCycles) / nanoseconds;
+    }
+    return cyclesPerNanosecond;
+}
+
+// how many cycles it takes to read the cycle counter, which is taken off of every timing
+uint64_t TimerOverheadCycles()
+{
+    static uint64_t overhead = ~uint64_t(0);
+    if (overhead == ~uint64_t(0))
+    {
+        for (size_t i = 0; i < 1000; ++i)
+        {
+            uint64_t start = ReadCycles();
+            uint64_t end = ReadCycles();
+            overhead = std::min(overhead, end - start);
+        }
+    }
+    return overhead;
+}
+
+void FlushFromCache(const void* data, size_t size)
+{
+    const char* bytes = (const char*)data;
+    for (size_t offset = 0; offset < size; offset += 64)
+        _mm_clflush(bytes + offset);
+    _mm_clflush(bytes + size - 1);
+    _mm_mfence();
+}
+
+// A histogram with 16 linear buckets per power of 2, so percentiles are within about 6% of the real value,
+// no matter how big the values are.
+class LatencyHistogram
+{
+public:
+    LatencyHistogram() : m_buckets(16 + 60 * 16, 0), m_count(0), m_max(0) {}
+
+    void Add(uint64_t value)
+    {
+        m_buckets[BucketIndex(value)]++;
+        m_count++;
+        m_max = std::max(m_max, value);
+    }
+
+    // percentile is from 0 to 1. Returns the middle of the bucket that the percentile falls in.
+    double Percentile(double percentile) const
+    {
+        uint64_t target = uint64_t(std::ceil(percentile * double(m_count)));
+        uint64_t count = 0;
+        for (size_t index = 0; index < m_buckets.size(); ++index)
+        {
+            count += m_buckets[index];
+            if (count >= target && count > 0)
+                return BucketMiddle(index);
+        }
+        return double(m_max);
+    }
+
+    uint64_t Max() const { return m_max; }
+
+private:
+    static size_t BucketIndex(uint64_t value)
+    {
+        if (value < 16)
+            return size_t(value);
+        size_t log2 = 63;
+        while ((value >> log2) == 0)
+            log2--;
+        return 16 + (log2 - 4) * 16 + size_t((value >> (log2 - 4)) & 15);
+    }
+
+    static double BucketMiddle(size_t index)
+    {
+        if (index < 16)
+            return double(index);
+        size_t log2 = (index - 16) / 16 + 4;
+        size_t sub = (index - 16) % 16;
+        double bucketMin = double(uint64_t(16 + sub) << (log2 - 4));
+        double bucketSize = double(uint64_t(1) << (log2 - 4));
+        return bucketMin + bucketSize * 0.5;
+    }
+
+    std::vector<uint64_t> m_buckets;
+    uint64_t m_count;
+    uint64_t m_max;
+};
+
+// two sided 95% critical values of student's t distribution, by degrees of freedom
+double TCritical95(size_t degreesOfFreedom)
+{
+    static const double c_table[] =
+    {
+        0.0, 12.706, 4.303, 3.182, 2.776, 2.571, 2.447, 2.365, 2.306, 2.262, 2.228,
+        2.201, 2.179, 2.160, 2.145, 2.131, 2.120, 2.110, 2.101, 2.093, 2.086,
+        2.080, 2.074, 2.069, 2.064, 2.060, 2.056, 2.052, 2.048, 2.045, 2.042,
+    };
+    if (degreesOfFreedom < countof(c_table))
+        return c_table[degreesOfFreedom];
+    return 1.96;
+}
+
+struct BenchmarkResult
+{
+    LatencyHistogram histogram;     // in cycles
+    double mean;                    // in nanoseconds, the mean of the repetition means
+    double variance;                // of the repetition means
+    size_t repetitions;
+
+    double ConfidenceInterval95() const
+    {
+        return TCritical95(repetitions - 1) * std::sqrt(variance / double(repetitions));
+    }
+};
+
+BenchmarkResult BenchmarkSearch(TestListFn fn, const std::vector<size_t>& searchList, const std::vector<size_t>& searchValues, bool coldCache)
+{
+    uint64_t overhead = TimerOverheadCycles();
+    double cyclesPerNanosecond = CyclesPerNanosecond();
+
+    BenchmarkResult ret;
+    ret.repetitions = c_benchmarkRepetitions;
+
+    size_t guesses = 0;
+    std::vector<double> repetitionMeans;
+    for (size_t runIndex = 0; runIndex < c_benchmarkWarmupRuns + c_benchmarkRepetitions; ++runIndex)
+    {
+        bool warmup = runIndex < c_benchmarkWarmupRuns;
+        uint64_t totalCycles = 0;
+        for (size_t searchValue : searchValues)
+        {
+            if (coldCache)
+                FlushFromCache(searchList.data(), searchList.size() * sizeof(size_t));
+
+            uint64_t start = ReadCycles();
+            TestResults result = fn(searchList, searchValue);
+            uint64_t end = ReadCycles();
+
+            guesses += result.guesses;
+            uint64_t cycles = end - start > overhead ? end - start - overhead : 0;
+            totalCycles += cycles;
+            if (!warmup)
+                ret.histogram.Add(cycles);
+        }
+        if (!warmup)
+            repetitionMeans.push_back(double(totalCycles) / double(searchValues.size()) / cyclesPerNanosecond);
+    }
+
+    ret.mean = 0.0;
+    for (double mean : repetitionMeans)
+        ret.mean += mean;
+    ret.mean /= double(repetitionMeans.size());
+
+    ret.variance = 0.0;
+    for (double mean : repetitionMeans)
+        ret.variance += (mean - ret.mean) * (mean - ret.mean);
+    ret.variance /= double(repetitionMeans.size() - 1);
+
+    // so the searches can't be optimized away
+    if (guesses == 0)
+        printf("(no guesses)\n");
+
+    return ret;
+}
+
+// Benchmarks each search on each list, with a warm cache and a cold cache
+void BenchmarkHarness(const MakeListInfo* makeFns, size_t numMakeFns, const TestListInfo* testFns, size_t numTestFns, const std::vector<size_t>& allSearchValues)
+{
+    static std::random_device rd("dev/random");
+    static std::seed_seq fullSeed{ rd(), rd(), rd(), rd(), rd(), rd(), rd(), rd() };
+    static std::mt19937 rng(fullSeed);
+
+    std::vector<size_t> searchValues(allSearchValues.begin(), allSearchValues.begin() + std::min(allSearchValues.size(), c_benchmarkNumSearches));
+    double nanosecondsPerCycle = 1.0 / CyclesPerNanosecond();
+
+    std::vector<size_t> values, layout;
+    std::vector<BenchmarkResult> results(numTestFns);
+    for (size_t makeIndex = 0; makeIndex < numMakeFns; ++makeIndex)
+    {
+        makeFns[makeIndex].fn(values, c_maxNumValues, c_maxValue, rng);
+
+        for (int coldCache = 0; coldCache < 2; ++coldCache)
+        {
+            printf("Benchmark %s, %s cache (%zu repetitions of %zu searches, after %zu warmup runs), in nanoseconds:\n",
+                makeFns[makeIndex].name, coldCache ? "cold" : "warm", c_benchmarkRepetitions, searchValues.size(), c_benchmarkWarmupRuns);
+
+            size_t baselineIndex = numTestFns;
+            for (size_t testIndex = 0; testIndex < numTestFns; ++testIndex)
+            {
+                if (testFns[testIndex].layoutFn)
+                    testFns[testIndex].layoutFn(values, layout);
+                const std::vector<size_t>& searchList = testFns[testIndex].layoutFn ? layout : values;
+
+                results[testIndex] = BenchmarkSearch(testFns[testIndex].fn, searchList, searchValues, coldCache != 0);
+                if (testFns[testIndex].fn == TestList_BinarySearch<std::vector<size_t>>)
+                    baselineIndex = testIndex;
+            }
+
+            for (size_t testIndex = 0; testIndex < numTestFns; ++testIndex)
+            {
+                const BenchmarkResult& result = results[testIndex];
+                printf("  %s : p50 %0.1f, p90 %0.1f, p99 %0.1f, p99.9 %0.1f, max %0.1f, mean %0.2f +/- %0.2f",
+                    testFns[testIndex].name,
+                    result.histogram.Percentile(0.5) * nanosecondsPerCycle,
+                    result.histogram.Percentile(0.9) * nanosecondsPerCycle,
+                    result.histogram.Percentile(0.99) * nanosecondsPerCycle,
+                    result.histogram.Percentile(0.999) * nanosecondsPerCycle,
+                    double(result.histogram.Max()) * nanosecondsPerCycle,
+                    result.mean, result.ConfidenceInterval95());
+
+                // welch's t interval of the difference of the means, with the smaller degrees of freedom to be conservative
+                if (baselineIndex < numTestFns && baselineIndex != testIndex)
+                {
+                    const BenchmarkResult& baseline = results[baselineIndex];
+                    double difference = baseline.mean - result.mean;
+                    double standardError = std::sqrt(result.variance / double(result.repetitions) + baseline.variance / double(baseline.repetitions));
+                    double interval = TCritical95(std::min(result.repetitions, baseline.repetitions) - 1) * standardError;
+                    if (std::abs(difference) <= interval)
+                        printf(", no significant difference from %s", testFns[baselineIndex].name);
+                    else
+                        printf(", %0.2fx %s than %s (%0.2f +/- %0.2f)", difference > 0.0 ? baseline.mean / result.mean : result.mean / baseline.mean,
+                            difference > 0.0 ? "faster" : "slower", testFns[baselineIndex].name, std::abs(difference), interval);
+                }
+                printf("\n");
+            }
+            printf("\n");
+        }
+    }
+}
+
+// ------------------------ HOT KEY CACHE ------------------------
+
+// A small direct mapped cache that goes in front of a search function, and remembers the results of recent search values.
+// Each search value hashes to a single slot. A hit returns the results stored there without looking at the list, and a
+// miss does the search and stores its results in the slot, replacing whatever was there before. When most searches are
+// for a few thousand values, they all fit in the cache, which stays in L1/L2 while the list itself might not.
+class HotKeyCache
+{
+public:
+    HotKeyCache(size_t numSlots)
+    {
+        m_slots.resize(numSlots);
+        m_shift = 64;
+        while ((size_t(1) << (64 - m_shift)) < numSlots)
+            m_shift--;
+        Clear();
+    }
+
+    // forgets all cached results. The cache needs to be cleared whenever the list it's in front of changes.
+    void Clear()
+    {
+        for (Slot& slot : m_slots)
+            slot.valid = false;
+        m_hits = 0;
+        m_misses = 0;
+    }
+
+    // Hits report 0 guesses, since they don't look at the list at all
+    TestResults Search(TestListFn fn, const std::vector<size_t>& values, size_t searchValue)
+    {
+        Slot& slot = m_slots[SlotIndex(searchValue)];
+        if (slot.valid && slot.searchValue == searchValue)
+        {
+            m_hits++;
+            return TestResults{ slot.found, slot.index, 0 };
+        }
+
+        m_misses++;
+        TestResults ret = fn(values, searchValue);
+        slot.searchValue = searchValue;
+        slot.index = ret.index;
+        slot.found = ret.found;
+        slot.valid = true;
+        return ret;
+    }
+
+    size_t Hits() const { return m_hits; }
+    size_t Misses() const { return m_misses; }
+
+private:
+    struct Slot
+    {
+        size_t searchValue;
+        size_t index;
+        bool found;
+        bool valid;
+    };
+
+    // fibonacci hashing, so that runs of nearby search values spread out over the slots
+    size_t SlotIndex(size_t searchValue) const
+    {
+        if (m_shift >= 64)
+            return 0;
+        return size_t((uint64_t(searchValue) * 11400714819323198485ull) >> m_shift);
+    }
+
+    std::vector<Slot> m_slots;
+    size_t m_shift;
+    size_t m_hits;
+    size_t m_misses;
+};
+
+// Times each search on a big list, with and without a hot key cache in front of it, for each kind of search values
+void HotKeyCacheTest(const TestListInfo* testFns, size_t numTestFns, const MakeSearchValuesInfo* searchValueFns, size_t numSearchValueFns)
+{
+    static std::random_device rd("dev/random");
+    static std::seed_seq fullSeed{ rd(), rd(), rd(), rd(), rd(), rd(), rd(), rd() };
+    static std::mt19937 rng(fullSeed);
+
+    size_t maxValue = c_hotKeyCacheTestNumValues * 2;
+    std::vector<size_t> values, layout, searchValues;
+    MakeList_Random(values, c_hotKeyCacheTestNumValues, maxValue, rng);
+
+    std::vector<TestResults> results, cachedResults;
+    results.resize(c_hotKeyCacheTestNumSearches);
+    cachedResults.resize(c_hotKeyCacheTestNumSearches);
+
+    HotKeyCache cache(c_hotKeyCacheSize);
+
+    printf("Hot key cache of %zu slots, in front of searches of a random list of %zu values:\n", c_hotKeyCacheSize, c_hotKeyCacheTestNumValues);
+    for (size_t searchValuesIndex = 0; searchValuesIndex < numSearchValueFns; ++searchValuesIndex)
+    {
+        searchValueFns[searchValuesIndex].fn(searchValues, c_hotKeyCacheTestNumSearches, maxValue, rng);
+
+        printf("  %s search values:\n", searchValueFns[searchValuesIndex].name);
+        for (size_t testIndex = 0; testIndex < numTestFns; ++testIndex)
+        {
+            // linear search is O(n), which is far too slow for a list this size
+            if (testFns[testIndex].fn == TestList_LinearSearch<std::vector<size_t>>)
+                continue;
+
+            if (testFns[testIndex].layoutFn)
+                testFns[testIndex].layoutFn(values, layout);
+            const std::vector<size_t>& searchList = testFns[testIndex].layoutFn ? layout : values;
+
+            std::chrono::high_resolution_clock::time_point start = std::chrono::high_resolution_clock::now();
+            for (size_t searchIndex = 0; searchIndex < searchValues.size(); ++searchIndex)
+                results[searchIndex] = testFns[testIndex].fn(searchList, searchValues[searchIndex]);
+            std::chrono::high_resolution_clock::time_point end = std::chrono::high_resolution_clock::now();
+            double seconds = std::chrono::duration_cast<std::chrono::duration<double>>(end - start).count();
+
+            // the cache starts out empty, so the time includes warming it up
+            cache.Clear();
+            start = std::chrono::high_resolution_clock::now();
+            for (size_t searchIndex = 0; searchIndex < searchValues.size(); ++searchIndex)
+                cachedResults[searchIndex] = cache.Search(testFns[testIndex].fn, searchList, searchValues[searchIndex]);
+            end = std::chrono::high_resolution_clock::now();
+            double cachedSeconds = std::chrono::duration_cast<std::chrono::duration<double>>(end - start).count();
+
+            #if VERIFY_RESULT()
+            for (size_t searchIndex = 0; searchIndex < searchValues.size(); ++searchIndex)
+            {
+                if (cachedResults[searchIndex].found != results[searchIndex].found || cachedResults[searchIndex].index != results[searchIndex].index)
+                {
+                    printf("VERIFICATION FAILURE!! Hot key cache result differs from uncached result! %s, %s\n", searchValueFns[searchValuesIndex].name, testFns[testIndex].name);
+                    break;
+                }
+            }
+            #endif
+
+            double hitRate = double(cache.Hits()) / double(cache.Hits() + cache.Misses());
+            printf("    %s : %f seconds uncached, %f seconds cached (%0.1f%% hit rate, %0.2fx speedup)\n", testFns[testIndex].name, seconds, cachedSeconds, hitRate * 100.0, seconds / cachedSeconds);
+        }
+    }
+    printf("\n");
+}
+
+// ------------------------ UPDATABLE SORTED LIST ------------------------
+
+// A sorted list that can have values inserted and removed, without re-sorting or shifting the whole list each time.
+// Inserts and removes go into small sorted delta buffers in front of the sorted list. A remove is a tombstone that
+// cancels one copy of a value in the sorted list. When the deltas fill up, they are frozen and merged into a new copy
+// of the sorted list on a background thread, while searches and updates carry on against the old list plus the frozen
+// and new deltas. The finished list is swapped in by the next operation after the merge is done.
+//
+// The sorted list itself never changes between merges, so its end points, and the line fit made from them, are exact
+// the whole time. Line fit and hybrid searches of it stay as fast as they are on a list that never changes, and the
+// only extra cost per search is binary searching the deltas, which are small enough to stay in cache.
+//
+// This isn't thread safe. One thread uses it, and the background merge only touches the frozen data and the new list.
+class UpdatableSortedList
+{
+public:
+    UpdatableSortedList(TestListFn searchFn, const std::vector<size_t>& values)
+        : m_searchFn(searchFn)
+        , m_values(values)
+        , m_merging(false)
+        , m_mergeDone(false)
+        , m_numMerges(0)
+    {
+    }
+
+    ~UpdatableSortedList()
+    {
+        if (m_mergeThread.joinable())
+            m_mergeThread.join();
+    }
+
+    void Insert(size_t value)
+    {
+        CheckMerge();
+        m_inserts.insert(std::upper_bound(m_inserts.begin(), m_inserts.end(), value), value);
+        StartMergeIfFull();
+    }
+
+    // Removes one copy of the value. Returns false if the value isn't in the list.
+    bool Remove(size_t value)
+    {
+        CheckMerge();
+
+        // a pending insert of the value can just be cancelled
+        std::vector<size_t>::iterator it = std::lower_bound(m_inserts.begin(), m_inserts.end(), value);
+        if (it != m_inserts.end() && *it == value)
+        {
+            m_inserts.erase(it);
+            return true;
+        }
+
+        if (Count(value) == 0)
+            return false;
+
+        m_removes.insert(std::upper_bound(m_removes.begin(), m_removes.end(), value), value);
+        StartMergeIfFull();
+        return true;
+    }
+
+    // The index returned is where the value is (the first copy of it, if there are duplicates), or where it would be
+    // inserted, in the list as it would be with every update merged in. Guesses are only counted in the sorted list.
+    TestResults Search(size_t searchValue)
+    {
+        CheckMerge();
+
+        // the search functions need at least one value to look at
+        TestResults ret = { false, 0, 0 };
+        if (!m_values.empty())
+            ret = m_searchFn(m_values, searchValue);
+        size_t index = LowerBoundFromResult(ret, searchValue);
+        ret.index = index
+            + LowerBound(m_mergingInserts, searchValue) - LowerBound(m_mergingRemoves, searchValue)
+            + LowerBound(m_inserts, searchValue) - LowerBound(m_removes, searchValue);
+
+        // the value could have been inserted since the last merge, or every copy of it removed
+        if (Contains(m_mergingInserts, searchValue) || Contains(m_inserts, searchValue) ||
+            Contains(m_mergingRemoves, searchValue) || Contains(m_removes, searchValue))
+            ret.found = Count(searchValue) > 0;
+        return ret;
+    }
+
+    // Waits for any background merge to finish, and then merges the rest of the updates into the sorted list
+    void Flush()
+    {
+        if (m_merging)
+        {
+            m_mergeThread.join();
+            FinishMerge();
+        }
+        if (!m_inserts.empty() || !m_removes.empty())
+        {
+            std::vector<size_t> merged;
+            MergeDeltas(m_values, m_inserts, m_removes, merged);
+            m_values.swap(merged);
+            m_inserts.clear();
+            m_removes.clear();
+            m_numMerges++;
+        }
+    }
+
+    // Only up to date after a Flush()
+    const std::vector<size_t>& Values() const { return m_values; }
+
+    size_t NumMerges() const { return m_numMerges; }
+
+private:
+    // The search functions only have to find a copy of the value, or a place next to where it would go if it isn't
+    // there, so this walks from there to the first index with a value that isn't less than the search value.
+    size_t LowerBoundFromResult(const TestResults& result, size_t searchValue) const
+    {
+        size_t index = result.index;
+        while (index < m_values.size() && m_values[index] < searchValue)
+            index++;
+        while (index > 0 && m_values[index - 1] >= searchValue)
+            index--;
+        return index;
+    }
+
+    static size_t LowerBound(const std::vector<size_t>& values, size_t searchValue)
+    {
+        return std::lower_bound(values.begin(), values.end(), searchValue) - values.begin();
+    }
+
+    static bool Contains(const std::vector<size_t>& values, size_t searchValue)
+    {
+        return std::binary_search(values.begin(), values.end(), searchValue);
+    }
+
+    static size_t CountOf(const std::vector<size_t>& values, size_t searchValue)
+    {
+        std::pair<std::vector<size_t>::const_iterator, std::vector<size_t>::const_iterator> range = std::equal_range(values.begin(), values.end(), searchValue);
+        return range.second - range.first;
+    }
+
+    // how many copies of the value there are, with every update merged in
+    size_t Count(size_t searchValue) const
+    {
+        size_t count = CountOf(m_values, searchValue) + CountOf(m_mergingInserts, searchValue) + CountOf(m_inserts, searchValue);
+        size_t removed = CountOf(m_mergingRemoves, searchValue) + CountOf(m_removes, searchValue);
+        return count - removed;
+    }
+
+    // Every remove cancels a copy of a value in values, since removes of pending inserts cancel the insert instead
+    static void MergeDeltas(const std::vector<size_t>& values, const std::vector<size_t>& inserts, const std::vector<size_t>& removes, std::vector<size_t>& merged)
+    {
+        merged.clear();
+        merged.reserve(values.size() + inserts.size() - removes.size());
+
+        size_t insertIndex = 0;
+        size_t removeIndex = 0;
+        for (size_t value : values)
+        {
+            while (insertIndex < inserts.size() && inserts[insertIndex] < value)
+                merged.push_back(inserts[insertIndex++]);
+
+            if (removeIndex < removes.size() && removes[removeIndex] == value)
+            {
+                removeIndex++;
+                continue;
+            }
+
+            merged.push_back(value);
+        }
+        while (insertIndex < inserts.size())
+            merged.push_back(inserts[insertIndex++]);
+    }
+
+    void StartMergeIfFull()
+    {
+        if (m_inserts.size() + m_removes.size() < c_updatableDeltaMaxSize)
+            return;
+
+        // if the last merge isn't done yet, there's nothing to do but wait for it
+        if (m_merging)
+        {
+            m_mergeThread.join();
+            FinishMerge();
+        }
+
+        m_mergingInserts.swap(m_inserts);
+        m_mergingRemoves.swap(m_removes);
+        m_inserts.clear();
+        m_removes.clear();
+
+        m_merging = true;
+        m_mergeDone.store(false, std::memory_order_relaxed);
+        m_mergeThread = std::thread(
+            [this]()
+            {
+                MergeDeltas(m_values, m_mergingInserts, m_mergingRemoves, m_mergedValues);
+                m_mergeDone.store(true, std::memory_order_release);
+            }
+        );
+    }
+
+    void CheckMerge()
+    {
+        if (m_merging && m_mergeDone.load(std::memory_order_acquire))
+        {
+            m_mergeThread.join();
+            FinishMerge();
+        }
+    }
+
+    // the merge thread must be joined before calling this
+    void FinishMerge()
+    {
+        m_values.swap(m_mergedValues);
+        m_mergedValues.clear();
+        m_mergingInserts.clear();
+        m_mergingRemoves.clear();
+        m_merging = false;
+        m_numMerges++;
+    }
+
+    TestListFn m_searchFn;
+    std::vector<size_t> m_values;
+
+    std::vector<size_t> m_inserts;
+    std::vector<size_t> m_removes;
+
+    // the frozen deltas being merged, and the list they are being merged into
+    std::vector<size_t> m_mergingInserts;
+    std::vector<size_t> m_mergingRemoves;
+    std::vector<size_t> m_mergedValues;
+
+    std::thread m_mergeThread;
+    bool m_merging;
+    std::atomic<bool> m_mergeDone;
+    size_t m_numMerges;
+};
+
+// Times mixes of searches, inserts and removes on an updatable sorted list, for each test that searches the sorted list directly
+void UpdatableListTest(const TestListInfo* testFns, size_t numTestFns)
+{
+    static std::random_device rd("dev/random");
+    static std::seed_seq fullSeed{ rd(), rd(), rd(), rd(), rd(), rd(), rd(), rd() };
+    static std::mt19937 rng(fullSeed);
+
+    static const double c_writeRatios[] = { 0.0, 0.01, 0.1, 0.5 };
+
+    size_t maxValue = c_updatableTestNumValues * 2;
+    std::vector<size_t> values;
+    MakeList_Random(values, c_updatableTestNumValues, maxValue, rng);
+
+    std::uniform_int_distribution<size_t> valueDist(0, maxValue);
+    std::uniform_int_distribution<size_t> indexDist(0, values.size() - 1);
+    std::uniform_real_distribution<double> opDist(0.0, 1.0);
+
+    printf("Updatable sorted list of %zu values, with deltas of up to %zu updates merged in the background:\n", c_updatableTestNumValues, c_updatableDeltaMaxSize);
+    for (size_t testIndex = 0; testIndex < numTestFns; ++testIndex)
+    {
+        // linear search is O(n), which is far too slow for a list this size, and layouts would need to be remade on every merge
+        if (testFns[testIndex].fn == TestList_LinearSearch<std::vector<size_t>> || testFns[testIndex].layoutFn)
+            continue;
+
+        printf("  %s :\n", testFns[testIndex].name);
+        for (double writeRatio : c_writeRatios)
+        {
+            UpdatableSortedList list(testFns[testIndex].fn, values);
+
+            // half of the writes are inserts of random values, and half are removes of values that were in the starting list
+            size_t numSearches = 0;
+            size_t numWrites = 0;
+            size_t guesses = 0;
+            std::chrono::high_resolution_clock::time_point start = std::chrono::high_resolution_clock::now();
+            for (size_t opIndex = 0; opIndex < c_updatableTestNumOperations; ++opIndex)
+            {
+                double op = opDist(rng);
+                if (op < writeRatio * 0.5)
+                {
+                    list.Insert(valueDist(rng));
+                    numWrites++;
+                }
+                else if (op < writeRatio)
+                {
+                    list.Remove(values[indexDist(rng)]);
+                    numWrites++;
+                }
+                else
+                {
+                    guesses += list.Search(valueDist(rng)).guesses;
+                    numSearches++;
+                }
+            }
+            std::chrono::high_resolution_clock::time_point end = std::chrono::high_resolution_clock::now();
+            double seconds = std::chrono::duration_cast<std::chrono::duration<double>>(end - start).count();
+            size_t numMerges = list.NumMerges();
+
+            #if VERIFY_RESULT()
+            // check searches against the list with every update merged in
+            {
+                std::vector<size_t> searchValues;
+                for (size_t i = 0; i < 1000; ++i)
+                    searchValues.push_back(valueDist(rng));
+
+                std::vector<TestResults> results;
+                for (size_t searchValue : searchValues)
+                    results.push_back(list.Search(searchValue));
+
+                list.Flush();
+                const std::vector<size_t>& merged = list.Values();
+                for (size_t i = 0; i < searchValues.size(); ++i)
+                {
+                    size_t lowerBound = std::lower_bound(merged.begin(), merged.end(), searchValues[i]) - merged.begin();
+                    bool found = lowerBound < merged.size() && merged[lowerBound] == searchValues[i];
+                    if (results[i].found != found || results[i].index != lowerBound || !std::is_sorted(merged.begin(), merged.end()))
+                    {
+                        printf("VERIFICATION FAILURE!! Updatable list search is wrong! %s, %0.0f%% writes\n", testFns[testIndex].name, writeRatio * 100.0);
+                        break;
+                    }
+                }
+            }
+            #endif
+
+            printf("    %0.0f%% writes : %f seconds, %0.2f M operations/s (%zu searches averaging %0.2f guesses, %zu writes, %zu merges)\n",
+                writeRatio * 100.0, seconds, double(c_updatableTestNumOperations) / seconds / 1000000.0, numSearches,
+                numSearches > 0 ? double(guesses) / double(numSearches) : 0.0, numWrites, numMerges);
+        }
+    }
+    printf("\n");
+}
+
+// ------------------------ SORTED LIST FILES ------------------------
+
+// A sorted list can be saved to a file and memory mapped back in, so the searches can run directly on the
+// mapping, without reading and copying the list into a std::vector first.
+// The file is a header, followed by the values at c_sortedListFileDataOffset, which is page aligned.
+// The header has the min and max values, and the line fit of the end points, which the mapped list's EndPointArrayView
+// gives to the searches, so they don't touch the first and last page of the values to get them.
+
+static const uint32_t c_sortedListFileMagic = 0x4C53464C; // "LFSL"
+static const uint32_t c_sortedListFileVersion = 3;
+static const uint32_t c_sortedListFileDataOffset = 4096;
+
+struct SortedListFileHeader
+{
+    uint32_t magic;
+    uint32_t version;
+    uint64_t count;
+    uint32_t valueBytes;  // sizeof() of the value type, which is an unsigned integer
+    uint32_t dataOffset;  // where the values start in the file
+    uint64_t minValue;
+    uint64_t maxValue;
+    double lineFitM;      // the line fit of the end points: value = m * index + b
+    double lineFitB;
+};
+
+// How pages of the mapping get loaded
+enum MapMode
+{
+    MapMode_Lazy,     // pages are loaded by page faults the first time they are read
+    MapMode_Populate, // all pages are loaded when the file is mapped (MAP_POPULATE on linux, touching every page on windows)
+    MapMode_WillNeed, // the OS is told all pages will be needed, and reads them ahead in the background (madvise / PrefetchVirtualMemory)
+
+    MapMode_Count
+};
+
+static const char* c_mapModeNames[MapMode_Count] =
+{
+    "Lazy",
+    "Populate",
+    "Will Need",
+};
+
+template <typename TKey>
+bool WriteSortedListFile(const char* fileName, const std::vector<TKey>& values)
+{
+    static_assert(std::is_unsigned<TKey>::value, "Sorted list files hold unsigned integer values");
+
+    if (values.empty())
+        return false;
+
+    SortedListFileHeader header;
+    memset(&header, 0, sizeof(header));
+    header.magic = c_sortedListFileMagic;
+    header.version = c_sortedListFileVersion;
+    header.count = values.size();
+    header.valueBytes = sizeof(TKey);
+    header.dataOffset = c_sortedListFileDataOffset;
+    header.minValue = values.front();
+    header.maxValue = values.back();
+    header.lineFitM = values.size() > 1 ? (double(values.back()) - double(values.front())) / double(values.size() - 1) : 0.0;
+    header.lineFitB = double(values.front());
+
+    FILE* file = nullptr;
+    fopen_s(&file, fileName, "wb");
+    if (!file)
+        return false;
+
+    std::vector<char> padding;
+    padding.resize(c_sortedListFileDataOffset - sizeof(header), 0);
+    bool success = fwrite(&header, sizeof(header), 1, file) == 1;
+    success = success && fwrite(padding.data(), padding.size(), 1, file) == 1;
+    success = success && fwrite(values.data(), sizeof(TKey), values.size(), file) == values.size();
+    fclose(file);
+    return success;
+}
+
+struct MappedSortedList
+{
+    const SortedListFileHeader* header = nullptr;
+    size_t mappedBytes = 0;
+#ifdef _WIN32
+    HANDLE file = INVALID_HANDLE_VALUE;
+    HANDLE mapping = nullptr;
+#else
+    int file = -1;
+#endif
+};
+
+void UnmapSortedListFile(MappedSortedList& mapped)
+{
+#ifdef _WIN32
+    if (mapped.header)
+        UnmapViewOfFile(mapped.header);
+    if (mapped.mapping)
+        CloseHandle(mapped.mapping);
+    if (mapped.file != INVALID_HANDLE_VALUE)
+        CloseHandle(mapped.file);
+#else
+    if (mapped.header)
+        munmap((void*)mapped.header, mapped.mappedBytes);
+    if (mapped.file >= 0)
+        close(mapped.file);
+#endif
+    mapped = MappedSortedList();
+}
+
+bool MapSortedListFile(const char* fileName, MapMode mode, MappedSortedList& mapped)
+{
+    mapped = MappedSortedList();
+
+#ifdef _WIN32
+    mapped.file = CreateFileA(fileName, GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+    if (mapped.file == INVALID_HANDLE_VALUE)
+        return false;
+
+    LARGE_INTEGER fileSize;
+    mapped.mapping = CreateFileMappingA(mapped.file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+    if (!GetFileSizeEx(mapped.file, &fileSize) || !mapped.mapping)
+    {
+        UnmapSortedListFile(mapped);
+        return false;
+    }
+    mapped.mappedBytes = size_t(fileSize.QuadPart);
+    mapped.header = (const SortedListFileHeader*)MapViewOfFile(mapped.mapping, FILE_MAP_READ, 0, 0, 0);
+#else
+    mapped.file = open(fileName, O_RDONLY);
+    if (mapped.file < 0)
+        return false;
+
+    struct stat fileStat;
+    if (fstat(mapped.file, &fileStat) != 0)
+    {
+        UnmapSortedListFile(mapped);
+        return false;
+    }
+    mapped.mappedBytes = size_t(fileStat.st_size);
+
+    int flags = MAP_SHARED;
+#ifdef MAP_POPULATE
+    if (mode == MapMode_Populate)
+        flags |= MAP_POPULATE;
+#endif
+    void* address = mmap(nullptr, mapped.mappedBytes, PROT_READ, flags, mapped.file, 0);
+    mapped.header = (address == MAP_FAILED) ? nullptr : (const SortedListFileHeader*)address;
+#endif
+
+    // make sure the file is a sorted list file, that its values are a supported key size and are aligned,
+    // and that it is as big as the header says it is
+    const SortedListFileHeader* header = mapped.header;
+    if (!header ||
+        mapped.mappedBytes < sizeof(SortedListFileHeader) ||
+        header->magic != c_sortedListFileMagic ||
+        header->version != c_sortedListFileVersion ||
+        header->count == 0 ||
+        (header->valueBytes != sizeof(uint32_t) && header->valueBytes != sizeof(uint64_t)) ||
+        header->dataOffset < sizeof(SortedListFileHeader) ||
+        header->dataOffset > mapped.mappedBytes ||
+        header->dataOffset % header->valueBytes != 0 ||
+        header->minValue > header->maxValue ||
+        (mapped.mappedBytes - header->dataOffset) / header->valueBytes < header->count)
+    {
+        UnmapSortedListFile(mapped);
+        return false;
+    }
+
+    const char* data = (const char*)mapped.header;
+    switch (mode)
+    {
+        case MapMode_Populate:
+        {
+#ifdef _WIN32
+            // windows has no populate flag, so read a byte from every page
+            volatile char touch = 0;
+            for (size_t offset = 0; offset < mapped.mappedBytes; offset += 4096)
+                touch += data[offset];
+#elif !defined(MAP_POPULATE)
+            madvise((void*)data, mapped.mappedBytes, MADV_WILLNEED);
+#endif
+            break;
+        }
+        case MapMode_WillNeed:
+        {
+#ifdef _WIN32
+            WIN32_MEMORY_RANGE_ENTRY range;
+            range.VirtualAddress = (void*)data;
+            range.NumberOfBytes = mapped.mappedBytes;
+            PrefetchVirtualMemory(GetCurrentProcess(), 1, &range, 0);
+#else
+            madvise((void*)data, mapped.mappedBytes, MADV_WILLNEED);
+#endif
+            break;
+        }
+        default: break;
+    }
+
+    return true;
+}
+
+// Returns the values of a mapped list, with the end points and line fit from the header, or an empty view if the values
+// in the file aren't TKeys
+template <typename TKey>
+EndPointArrayView<TKey> GetMappedValues(const MappedSortedList& mapped)
+{
+    const SortedListFileHeader* header = mapped.header;
+    if (!header || header->valueBytes != sizeof(TKey))
+        return EndPointArrayView<TKey>(nullptr, 0, TKey(0), TKey(0), 0.0f, 0.0f);
+    return EndPointArrayView<TKey>((const TKey*)((const char*)header + header->dataOffset), size_t(header->count),
+        TKey(header->minValue), TKey(header->maxValue), float(header->lineFitM), float(header->lineFitB));
+}
+
+// Drops a file from the OS file cache, so the next time it's read, it comes from disk.
+// Only supported on linux. Returns false if it couldn't be done.
+bool EvictFileFromCache(const char* fileName)
+{
+#ifdef __linux__
+    int file = open(fileName, O_RDONLY);
+    if (file < 0)
+        return false;
+
+    // dirty pages can't be dropped, so make sure they've been written first
+    bool success = fsync(file) == 0 && posix_fadvise(file, 0, 0, POSIX_FADV_DONTNEED) == 0;
+    close(file);
+    return success;
+#else
+    return false;
+#endif
+}
+
+template <typename TKernel>
+void MappedFileTest_Search(const char* fileName, MapMode mode, const std::vector<size_t>& list, const std::vector<size_t>& searchValues)
+{
+    bool evicted = EvictFileFromCache(fileName);
+
+    std::chrono::high_resolution_clock::time_point mapStart = std::chrono::high_resolution_clock::now();
+    MappedSortedList mapped;
+    if (!MapSortedListFile(fileName, mode, mapped))
+    {
+        printf("Could not map %s\n", fileName);
+        return;
+    }
+    std::chrono::high_resolution_clock::time_point mapEnd = std::chrono::high_resolution_clock::now();
+
+    EndPointArrayView<size_t> values = GetMappedValues<size_t>(mapped);
+
+    // the first pass over the searches reads pages for the first time, the second pass runs on pages that are already loaded
+    double passSeconds[2];
+    size_t guesses = 0;
+    std::vector<TestResults> results(searchValues.size());
+    for (int pass = 0; pass < 2; ++pass)
+    {
+        std::chrono::high_resolution_clock::time_point start = std::chrono::high_resolution_clock::now();
+
+        for (size_t searchIndex = 0; searchIndex < searchValues.size(); ++searchIndex)
+        {
+            results[searchIndex] = TKernel::Search(values, searchValues[searchIndex]);
+            guesses += results[searchIndex].guesses;
+        }
+
+        std::chrono::high_resolution_clock::time_point end = std::chrono::high_resolution_clock::now();
+        passSeconds[pass] = std::chrono::duration_cast<std::chrono::duration<double>>(end - start).count();
+
+        // checked against the list the file was written from, so a wrong data offset or count shows up
+        #if VERIFY_RESULT()
+        size_t failures = 0;
+        for (size_t searchIndex = 0; searchIndex < searchValues.size(); ++searchIndex)
+        {
+            size_t searchValue = searchValues[searchIndex];
+            const TestResults& ret = results[searchIndex];
+            if (values.size() != list.size() || ret.index >= list.size() || (ret.found ? list[ret.index] != searchValue :
+                (ret.index > 0 && list[ret.index - 1] > searchValue) || (ret.index + 1 < list.size() && list[ret.index + 1] < searchValue)))
+                failures++;
+        }
+        if (failures > 0)
+            printf("VERIFICATION FAILURE!! %zu wrong results %s! %s %s\n", failures, pass == 0 ? "cold" : "warm", TKernel::Name(), c_mapModeNames[mode]);
+        #endif
+    }
+
+    double mapSeconds = std::chrono::duration_cast<std::chrono::duration<double>>(mapEnd - mapStart).count();
+    double coldNanoseconds = passSeconds[0] * 1000.0 * 1000.0 * 1000.0 / double(searchValues.size());
+    double warmNanoseconds = passSeconds[1] * 1000.0 * 1000.0 * 1000.0 / double(searchValues.size());
+    double guessesPerSearch = double(guesses) / double(searchValues.size() * 2);
+    printf("  %s %s%s : mapped in %f seconds, %f nanoseconds per search cold, %f nanoseconds per search warm (%f guesses per search)\n",
+        TKernel::Name(), c_mapModeNames[mode], evicted ? "" : " (file cache not flushed)", mapSeconds, coldNanoseconds, warmNanoseconds, guessesPerSearch);
+
+    UnmapSortedListFile(mapped);
+}
+
+template <typename TKernel>
+void MappedFileTest_Search(const char* fileName, const std::vector<size_t>& list, const std::vector<size_t>& searchValues)
+{
+    for (int mode = 0; mode < MapMode_Count; ++mode)
+        MappedFileTest_Search<TKernel>(fileName, MapMode(mode), list, searchValues);
+}
+
+void MappedFileTest()
+{
+    static std::random_device rd("dev/random");
+    static std::seed_seq fullSeed{ rd(), rd(), rd(), rd(), rd(), rd(), rd(), rd() };
+    static std::mt19937 rng(fullSeed);
+
+    const char* fileName = "out/SortedList.bin";
+    size_t maxValue = c_mappedFileNumValues * 2;
+    std::vector<size_t> values;
+    MakeList_Random(values, c_mappedFileNumValues, maxValue, rng);
+    if (!WriteSortedListFile(fileName, values))
+    {
+        printf("Could not write %s\n", fileName);
+        return;
+    }
+
+    std::vector<size_t> searchValues;
+    searchValues.resize(c_mappedFileNumSearches);
+    std::uniform_int_distribution<size_t> dist(0, maxValue);
+    for (size_t& v : searchValues)
+        v = dist(rng);
+
+    printf("Memory mapped sorted list of %zu values:\n", c_mappedFileNumValues);
+    MappedFileTest_Search<Kernel_LineFit>(fileName, values, searchValues);
+    MappedFileTest_Search<Kernel_BinarySearch>(fileName, values, searchValues);
+    MappedFileTest_Search<Kernel_HybridSearch>(fileName, values, searchValues);
+    MappedFileTest_Search<Kernel_AdaptiveSearch>(fileName, values, searchValues);
+    printf("\n");
+}
+
+// ------------------------ AUTO TUNER ------------------------
+
+// Profiles a sorted list when its index is built, and picks the search that is fastest on it. The list is cut into
+// segments of c_autoTuneSegmentSize values, and each segment gets its own search, so a list that is linear in one place
+// and skewed in another can use line fit where that works and binary search where it doesn't. A list no bigger than a
+// segment gets one search for the whole list.
+// Finding the segment costs guesses of its own, so the searches are also timed on the whole list, and if one of them
+// beats the segmented plan, the plan is that search on one segment that is the whole list.
+// A search finds its segment by binary searching the first value of each segment, then runs the segment's search on an
+// ArrayView of the segment, like the finger searches do.
+// The plan of which search each segment uses can be saved to a file and loaded back in, so a restart doesn't have to
+// tune the list again.
+
+struct SegmentProfile
+{
+    double linearity;     // r squared of the sampled indices against their values. 1 is a straight line.
+    double meanResidual;  // how many indices a sampled value is from where the line fit of the end points puts it, on average...
+    double maxResidual;   // ...and at most
+    double densityRatio;  // how many times denser the densest part of the segment is than the least dense part
+};
+
+struct SearchStrategy
+{
+    const char* name;
+    TestResults(*fn)(const ArrayView<size_t>& values, size_t searchValue);
+    bool lineFitOnly;  // only guesses with line fits, which can take O(N) guesses when values are far from the line
+    size_t maxValues;  // only tried on segments of at most this many values
+};
+
+// The searches the tuner picks from, named like they are in TestFns. The layouts aren't here, since they'd need a
+// layout made for each segment.
+static const SearchStrategy c_searchStrategies[] =
+{
+    {"Linear Search", TestList_LinearSearch<ArrayView<size_t>>, false, c_autoTuneMaxLinearSearch},
+    {"Line Fit", TestList_LineFit<ArrayView<size_t>>, true, ~size_t(0)},
+    {"Binary Search", TestList_BinarySearch<ArrayView<size_t>>, false, ~size_t(0)},
+    {"Hybrid", TestList_HybridSearch<ArrayView<size_t>>, false, ~size_t(0)},
+    {"Adaptive", TestList_AdaptiveSearch<ArrayView<size_t>>, false, ~size_t(0)},
+    {"Branchless Binary Search", TestList_BranchlessBinarySearch<ArrayView<size_t>>, false, ~size_t(0)},
+    {"Line Fit Integer", TestList_LineFitInteger<ArrayView<size_t>>, true, ~size_t(0)},
+    {"Hybrid Integer", TestList_HybridSearchInteger<ArrayView<size_t>>, false, ~size_t(0)},
+};
+
+static const uint32_t c_searchPlanFileMagic = 0x5053464C; // "LFSP"
+static const uint32_t c_searchPlanFileVersion = 2;
+static const size_t c_searchPlanNameLength = 32;
+
+struct SearchPlanFileHeader
+{
+    uint32_t magic;
+    uint32_t version;
+    uint64_t numValues;   // the plan is only used for a list with this many values...
+    uint64_t valuesHash;  // ...which hash to this
+    uint64_t segmentSize;  // c_autoTuneSegmentSize, or the number of values if the plan is one search for the whole list
+    uint64_t numSegments;
+};
+
+// one of these follows the header for each segment
+struct SearchPlanFileSegment
+{
+    char strategy[c_searchPlanNameLength];  // the name of the search, so the plan still works if c_searchStrategies changes order
+    SegmentProfile profile;
+};
+
+// FNV-1a of the values, to tell if a saved plan was made for these values
+uint64_t HashValues(const std::vector<size_t>& values)
+{
+    uint64_t hash = 14695981039346656037ull;
+    for (size_t value : values)
+    {
+        for (size_t byteIndex = 0; byteIndex < sizeof(size_t); ++byteIndex)
+        {
+            hash ^= (value >> (byteIndex * 8)) & 0xFF;
+            hash *= 1099511628211ull;
+        }
+    }
+    return hash;
+}
+
+SegmentProfile ProfileSegment(const ArrayView<size_t>& values)
+{
+    SegmentProfile profile = { 1.0, 0.0, 0.0, 1.0 };
+    size_t count = values.size();
+    if (count < 2)
+        return profile;
+
+    // residuals against the line fit of the end points, and the sums for r squared, over evenly spaced samples
+    double first = double(values[0]);
+    double last = double(values[count - 1]);
+    double indicesPerValue = last > first ? double(count - 1) / (last - first) : 0.0;
+    size_t numSamples = std::min(count, c_autoTuneProfileSamples);
+    double sumX = 0.0, sumY = 0.0, sumXX = 0.0, sumYY = 0.0, sumXY = 0.0;
+    for (size_t sampleIndex = 0; sampleIndex < numSamples; ++sampleIndex)
+    {
+        size_t index = sampleIndex * (count - 1) / (numSamples - 1);
+        double x = double(values[index]) - first;
+        double y = double(index);
+        double residual = std::abs(x * indicesPerValue - y);
+        profile.meanResidual += residual;
+        profile.maxResidual = std::max(profile.maxResidual, residual);
+
+        sumX += x;
+        sumY += y;
+        sumXX += x * x;
+        sumYY += y * y;
+        sumXY += x * y;
+    }
+    profile.meanResidual /= double(numSamples);
+
+    double n = double(numSamples);
+    double varianceX = n * sumXX - sumX * sumX;
+    double varianceY = n * sumYY - sumY * sumY;
+    if (varianceX > 0.0 && varianceY > 0.0)
+    {
+        double covariance = n * sumXY - sumX * sumY;
+        profile.linearity = (covariance * covariance) / (varianceX * varianceY);
+    }
+
+    // density is values per unit of value range, in each block of the segment
+    size_t numBlocks = std::min(count / 2, c_autoTuneProfileBlocks);
+    double minDensity = HUGE_VAL;
+    double maxDensity = 0.0;
+    for (size_t blockIndex = 0; blockIndex < numBlocks; ++blockIndex)
+    {
+        size_t blockBegin = count * blockIndex / numBlocks;
+        size_t blockEnd = count * (blockIndex + 1) / numBlocks;
+        double density = double(blockEnd - blockBegin) / (double(values[blockEnd - 1] - values[blockBegin]) + 1.0);
+        minDensity = std::min(minDensity, density);
+        maxDensity = std::max(maxDensity, density);
+    }
+    if (numBlocks > 0)
+        profile.densityRatio = maxDensity / minDensity;
+
+    return profile;
+}
+
+// Whether the tuner tries a search on values with this profile. Line fit is left out where the values are far from
+// the line, since it would take many guesses, and timing it would slow the tuning down for nothing.
+bool ShouldTryStrategy(const SearchStrategy& strategy, size_t count, const SegmentProfile& profile)
+{
+    if (count > strategy.maxValues)
+        return false;
+    if (strategy.lineFitOnly && profile.maxResidual > c_autoTuneMaxLineFitResidual * double(count))
+        return false;
+    return true;
+}
+
+class SearchPlan
+{
+public:
+    // Profiles each segment of the values, times the searches that suit the profile on it, and keeps the fastest.
+    // The searches for all segments are timed one at a time, shuffled together, so a segment is timed with the rest
+    // of the list competing for the cache like it will be when the plan is used, instead of with only it in the cache.
+    // Each search is timed like the benchmark harness times them, so the plan is for the lowest latency per search.
+    void Build(const std::vector<size_t>& values, std::mt19937& rng)
+    {
+        m_numValues = values.size();
+        m_valuesHash = HashValues(values);
+        m_segmentSize = c_autoTuneSegmentSize;
+        MakeDirectory(values);
+
+        size_t numSegments = m_segmentFirstValues.size();
+        m_strategies.resize(numSegments);
+        m_profiles.resize(numSegments);
+
+        // search values spread over the values of each segment, as (segment, search value) pairs
+        std::vector<std::pair<size_t, size_t>> searches;
+        searches.reserve(numSegments * c_autoTuneNumSearches);
+        for (size_t segmentIndex = 0; segmentIndex < numSegments; ++segmentIndex)
+        {
+            ArrayView<size_t> segment = GetSegment(values, segmentIndex);
+            m_profiles[segmentIndex] = ProfileSegment(segment);
+
+            std::uniform_int_distribution<size_t> dist(segment[0], segment[segment.size() - 1]);
+            for (size_t searchIndex = 0; searchIndex < c_autoTuneNumSearches; ++searchIndex)
+                searches.push_back(std::make_pair(segmentIndex, dist(rng)));
+        }
+        std::shuffle(searches.begin(), searches.end(), rng);
+
+        // cycles[segmentIndex * countof(c_searchStrategies) + strategyIndex], left at the max for searches that aren't tried
+        static const size_t numStrategies = countof(c_searchStrategies);
+        std::vector<uint64_t> cycles(numSegments * numStrategies, ~uint64_t(0));
+        for (size_t strategyIndex = 0; strategyIndex < numStrategies; ++strategyIndex)
+        {
+            const SearchStrategy& strategy = c_searchStrategies[strategyIndex];
+            for (size_t segmentIndex = 0; segmentIndex < numSegments; ++segmentIndex)
+            {
+                if (ShouldTryStrategy(strategy, GetSegment(values, segmentIndex).size(), m_profiles[segmentIndex]))
+                    cycles[segmentIndex * numStrategies + strategyIndex] = 0;
+            }
+
+            TimeSearches(searches,
+                [&](const std::pair<size_t, size_t>& search) -> uint64_t*
+                {
+                    uint64_t& segmentCycles = cycles[search.first * numStrategies + strategyIndex];
+                    return segmentCycles == ~uint64_t(0) ? nullptr : &segmentCycles;
+                },
+                [&](const std::pair<size_t, size_t>& search) { return strategy.fn(GetSegment(values, search.first), search.second); });
+        }
+
+        // binary search is tried on every segment, so every segment has a search to pick
+        for (size_t segmentIndex = 0; segmentIndex < numSegments; ++segmentIndex)
+        {
+            const uint64_t* segmentCycles = &cycles[segmentIndex * numStrategies];
+            m_strategies[segmentIndex] = uint8_t(std::min_element(segmentCycles, segmentCycles + numStrategies) - segmentCycles);
+        }
+
+        // A list no bigger than a segment is already one search for the whole list. For bigger lists, the segmented plan
+        // is timed with its directory search, against the searches that suit the whole list timed on the whole list.
+        if (numSegments < 2)
+            return;
+
+        uint64_t planCycles = 0;
+        TimeSearches(searches,
+            [&](const std::pair<size_t, size_t>& search) { return &planCycles; },
+            [&](const std::pair<size_t, size_t>& search) { return Search(values, search.second); });
+
+        ArrayView<size_t> wholeList(values.data(), values.size());
+        SegmentProfile wholeProfile = ProfileSegment(wholeList);
+        uint64_t bestCycles = planCycles;
+        size_t bestStrategy = numStrategies;
+        for (size_t strategyIndex = 0; strategyIndex < numStrategies; ++strategyIndex)
+        {
+            const SearchStrategy& strategy = c_searchStrategies[strategyIndex];
+            if (!ShouldTryStrategy(strategy, values.size(), wholeProfile))
+                continue;
+
+            uint64_t strategyCycles = 0;
+            TimeSearches(searches,
+                [&](const std::pair<size_t, size_t>& search) { return &strategyCycles; },
+                [&](const std::pair<size_t, size_t>& search) { return strategy.fn(wholeList, search.second); });
+            if (strategyCycles < bestCycles)
+            {
+                bestCycles = strategyCycles;
+                bestStrategy = strategyIndex;
+            }
+        }
+
+        if (bestStrategy < numStrategies)
+        {
+            m_segmentSize = values.size();
+            MakeDirectory(values);
+            m_strategies.assign(1, uint8_t(bestStrategy));
+            m_profiles.assign(1, wholeProfile);
+        }
+    }
+
+    bool Save(const char* fileName) const
+    {
+        FILE* file = nullptr;
+        fopen_s(&file, fileName, "wb");
+        if (!file)
+            return false;
+
+        SearchPlanFileHeader header;
+        memset(&header, 0, sizeof(header));
+        header.magic = c_searchPlanFileMagic;
+        header.version = c_searchPlanFileVersion;
+        header.numValues = m_numValues;
+        header.valuesHash = m_valuesHash;
+        header.segmentSize = m_segmentSize;
+        header.numSegments = m_strategies.size();
+        bool success = fwrite(&header, sizeof(header), 1, file) == 1;
+
+        for (size_t segmentIndex = 0; success && segmentIndex < m_strategies.size(); ++segmentIndex)
+        {
+            SearchPlanFileSegment segment;
+            memset(&segment, 0, sizeof(segment));
+            const char* name = c_searchStrategies[m_strategies[segmentIndex]].name;
+            memcpy(segment.strategy, name, std::min(strlen(name), c_searchPlanNameLength - 1));
+            segment.profile = m_profiles[segmentIndex];
+            success = fwrite(&segment, sizeof(segment), 1, file) == 1;
+        }
+
+        fclose(file);
+        return success;
+    }
+
+    // Loads a plan saved for these values. Fails if there is no file, if it was saved for different values or a segment
+    // size other than c_autoTuneSegmentSize or the whole list, or if it names a search that isn't in c_searchStrategies anymore.
+    bool Load(const char* fileName, const std::vector<size_t>& values)
+    {
+        FILE* file = nullptr;
+        fopen_s(&file, fileName, "rb");
+        if (!file)
+            return false;
+
+        SearchPlanFileHeader header;
+        bool success = fread(&header, sizeof(header), 1, file) == 1 &&
+            header.magic == c_searchPlanFileMagic &&
+            header.version == c_searchPlanFileVersion &&
+            header.numValues == values.size() &&
+            header.segmentSize > 0 &&
+            (header.segmentSize == c_autoTuneSegmentSize || (header.segmentSize == values.size() && header.numSegments == 1)) &&
+            header.numSegments == (values.size() + size_t(header.segmentSize) - 1) / size_t(header.segmentSize) &&
+            header.valuesHash == HashValues(values);
+
+        std::vector<uint8_t> strategies;
+        std::vector<SegmentProfile> profiles;
+        if (success)
+        {
+            strategies.resize(size_t(header.numSegments));
+            profiles.resize(size_t(header.numSegments));
+        }
+        for (size_t segmentIndex = 0; success && segmentIndex < strategies.size(); ++segmentIndex)
+        {
+            SearchPlanFileSegment segment;
+            success = fread(&segment, sizeof(segment), 1, file) == 1;
+            segment.strategy[c_searchPlanNameLength - 1] = 0;
+
+            size_t strategyIndex = 0;
+            while (success && strategyIndex < countof(c_searchStrategies) && strcmp(c_searchStrategies[strategyIndex].name, segment.strategy) != 0)
+                strategyIndex++;
+            success = success && strategyIndex < countof(c_searchStrategies);
+
+            strategies[segmentIndex] = uint8_t(strategyIndex);
+            profiles[segmentIndex] = segment.profile;
+        }
+        fclose(file);
+
+        if (!success)
+            return false;
+
+        m_numValues = size_t(header.numValues);
+        m_valuesHash = header.valuesHash;
+        m_segmentSize = size_t(header.segmentSize);
+        m_strategies.swap(strategies);
+        m_profiles.swap(profiles);
+        MakeDirectory(values);
+        return true;
+    }
+
+    TestResults Search(const std::vector<size_t>& values, size_t searchValue) const
+    {
+        if (values.empty())
+        {
+            TestResults ret;
+            ret.found = false;
+            ret.index = 0;
+            ret.guesses = 0;
+            return ret;
+        }
+
+        // find the last segment that starts at or before the search value. Anything before the list goes to the first segment.
+        // This is a branchless binary search, since which way it goes is as random as the search values are.
+        size_t guesses = 0;
+        size_t low = 0;
+        size_t count = m_segmentFirstValues.size();
+        while (count > 1)
+        {
+            guesses++;
+            size_t half = count / 2;
+            low = (m_segmentFirstValues[low + half] <= searchValue) ? low + half : low;
+            count -= half;
+        }
+
+        TestResults ret = c_searchStrategies[m_strategies[low]].fn(GetSegment(values, low), searchValue);
+        ret.index += low * m_segmentSize;
+        ret.guesses += guesses;
+        return ret;
+    }
+
+    size_t NumSegments() const { return m_strategies.size(); }
+    size_t SegmentSize() const { return m_segmentSize; }
+    size_t SegmentStrategy(size_t segmentIndex) const { return m_strategies[segmentIndex]; }
+    const SegmentProfile& GetSegmentProfile(size_t segmentIndex) const { return m_profiles[segmentIndex]; }
+
+private:
+    ArrayView<size_t> GetSegment(const std::vector<size_t>& values, size_t segmentIndex) const
+    {
+        size_t begin = segmentIndex * m_segmentSize;
+        return ArrayView<size_t>(&values[begin], std::min(m_segmentSize, values.size() - begin));
+    }
+
+    void MakeDirectory(const std::vector<size_t>& values)
+    {
+        m_segmentFirstValues.clear();
+        for (size_t begin = 0; begin < values.size(); begin += m_segmentSize)
+            m_segmentFirstValues.push_back(values[begin]);
+    }
+
+    // Times each search with fenced cycle counts, adding them to the counter cyclesFor returns for it, unless that is null.
+    // The first pass warms up the caches and branch predictors, the second is timed.
+    template <typename TCyclesFor, typename TSearch>
+    static void TimeSearches(const std::vector<std::pair<size_t, size_t>>& searches, const TCyclesFor& cyclesFor, const TSearch& search)
+    {
+        volatile size_t sink = 0;
+        for (int pass = 0; pass < 2; ++pass)
+        {
+            for (const std::pair<size_t, size_t>& searchPair : searches)
+            {
+                uint64_t* cycles = cyclesFor(searchPair);
+                if (!cycles)
+                    continue;
+
+                uint64_t start = ReadCycles();
+                TestResults ret = search(searchPair);
+                uint64_t end = ReadCycles();
+                sink = sink + ret.guesses;
+                if (pass == 1)
+                    *cycles += end - start;
+            }
+        }
+    }
+
+    size_t m_numValues = 0;
+    size_t m_segmentSize = c_autoTuneSegmentSize;
+    uint64_t m_valuesHash = 0;
+    std::vector<size_t> m_segmentFirstValues;  // the directory of segments
+    std::vector<uint8_t> m_strategies;         // index into c_searchStrategies for each segment
+    std::vector<SegmentProfile> m_profiles;
+};
+
+// Returns the seconds the searches took, and checks their results against the neighbors of the index they found
+template <typename TSearch>
+double AutoTuneTest_Time(const std::vector<size_t>& list, const std::vector<size_t>& searchValues, const char* name, size_t& guesses, const TSearch& search)
+{
+    guesses = 0;
+    std::chrono::high_resolution_clock::time_point start = std::chrono::high_resolution_clock::now();
+    for (size_t searchValue : searchValues)
+        guesses += search(searchValue).guesses;
+    std::chrono::high_resolution_clock::time_point end = std::chrono::high_resolution_clock::now();
+
+    #if VERIFY_RESULT()
+    size_t failures = 0;
+    for (size_t searchValue : searchValues)
+    {
+        TestResults ret = search(searchValue);
+        if (ret.found ? list[ret.index] != searchValue :
+            (ret.index > 0 && list[ret.index - 1] > searchValue) || (ret.index + 1 < list.size() && list[ret.index + 1] < searchValue))
+            failures++;
+    }
+    if (failures > 0)
+        printf("VERIFICATION FAILURE!! %zu wrong results! %s\n", failures, name);
+    #endif
+
+    return std::chrono::duration_cast<std::chrono::duration<double>>(end - start).count();
+}
+
+void AutoTuneTest()
+{
+    static std::random_device rd("dev/random");
+    static std::seed_seq fullSeed{ rd(), rd(), rd(), rd(), rd(), rd(), rd(), rd() };
+    static std::mt19937 rng(fullSeed);
+
+    MakeListInfo makeFns[] =
+    {
+        {"Random", MakeList_Random<size_t>},
+        {"Linear", MakeList_Linear<size_t>},
+        {"Linear Outlier", MakeList_Linear_Outlier<size_t>},
+        {"Quadratic", MakeList_Quadratic<size_t>},
+        {"Cubic", MakeList_Cubic<size_t>},
+        {"Log", MakeList_Log<size_t>},
+        {"Mixed", MakeList_Mixed<size_t>},
+    };
+
+    size_t maxValue = c_autoTuneTestNumValues * 2;
+    std::vector<size_t> values, searchValues;
+    searchValues.resize(c_autoTuneTestNumSearches);
+    std::uniform_int_distribution<size_t> dist(0, maxValue);
+    for (size_t& v : searchValues)
+        v = dist(rng);
+
+    printf("Auto tuned search plans, %zu values in segments of %zu:\n", c_autoTuneTestNumValues, c_autoTuneSegmentSize);
+    for (const MakeListInfo& makeFn : makeFns)
+    {
+        makeFn.fn(values, c_autoTuneTestNumValues, maxValue, rng);
+
+        // a plan saved by an earlier run is used if it was made for the same values. Otherwise the list is tuned again,
+        // and the plan saved and loaded back in, to check that it comes back the same.
+        char fileName[1024];
+        sprintf_s(fileName, "out/%s.plan", makeFn.name);
+        SearchPlan plan;
+        if (plan.Load(fileName, values))
+        {
+            printf("  %s : reused the plan in %s\n", makeFn.name, fileName);
+        }
+        else
+        {
+            std::chrono::high_resolution_clock::time_point start = std::chrono::high_resolution_clock::now();
+            plan.Build(values, rng);
+            std::chrono::high_resolution_clock::time_point end = std::chrono::high_resolution_clock::now();
+            double seconds = std::chrono::duration_cast<std::chrono::duration<double>>(end - start).count();
+
+            SearchPlan loadedPlan;
+            bool loaded = plan.Save(fileName) && loadedPlan.Load(fileName, values);
+            for (size_t segmentIndex = 0; loaded && segmentIndex < plan.NumSegments(); ++segmentIndex)
+                loaded = plan.SegmentStrategy(segmentIndex) == loadedPlan.SegmentStrategy(segmentIndex);
+            if (!loaded)
+                printf("Could not save and load %s\n", fileName);
+
+            printf("  %s : tuned in %f seconds, saved to %s\n", makeFn.name, seconds, fileName);
+        }
+
+        // the profiles, and how many segments use each search
+        double minLinearity = 1.0, maxResidual = 0.0, maxDensityRatio = 1.0;
+        size_t strategyCounts[countof(c_searchStrategies)] = {};
+        for (size_t segmentIndex = 0; segmentIndex < plan.NumSegments(); ++segmentIndex)
+        {
+            const SegmentProfile& profile = plan.GetSegmentProfile(segmentIndex);
+            minLinearity = std::min(minLinearity, profile.linearity);
+            maxResidual = std::max(maxResidual, profile.maxResidual);
+            maxDensityRatio = std::max(maxDensityRatio, profile.densityRatio);
+            strategyCounts[plan.SegmentStrategy(segmentIndex)]++;
+        }
+        printf("    segments have linearity of at least %0.4f, residuals of at most %0.1f indices, and density ratios of at most %0.2f\n", minLinearity, maxResidual, maxDensityRatio);
+        printf("    plan%s :", plan.NumSegments() == 1 && plan.SegmentSize() == values.size() ? " for the whole list" : "");
+        for (size_t strategyIndex = 0; strategyIndex < countof(c_searchStrategies); ++strategyIndex)
+        {
+            if (strategyCounts[strategyIndex] > 0)
+                printf(" %zu %s,", strategyCounts[strategyIndex], c_searchStrategies[strategyIndex].name);
+        }
+        printf("\n");
+
+        // the plan against each search on the whole list, tried by the same rules as for a segment
+        size_t guesses = 0;
+        double seconds = AutoTuneTest_Time(values, searchValues, "Auto Tuned", guesses,
+            [&](size_t searchValue) { return plan.Search(values, searchValue); });
+        printf("    Auto Tuned : %0.1f nanoseconds per search (%0.2f guesses per search)\n",
+            seconds * 1000.0 * 1000.0 * 1000.0 / double(searchValues.size()), double(guesses) / double(searchValues.size()));
+
+        ArrayView<size_t> view(values.data(), values.size());
+        SegmentProfile profile = ProfileSegment(view);
+        for (const SearchStrategy& strategy : c_searchStrategies)
+        {
+            if (!ShouldTryStrategy(strategy, values.size(), profile))
+                continue;
+
+            seconds = AutoTuneTest_Time(values, searchValues, strategy.name, guesses,
+                [&](size_t searchValue) { return strategy.fn(view, searchValue); });
+            printf("    %s : %0.1f nanoseconds per search (%0.2f guesses per search)\n", strategy.name,
+                seconds * 1000.0 * 1000.0 * 1000.0 / double(searchValues.size()), double(guesses) / double(searchValues.size()));
+        }
+    }
+    printf("\n");
+}
+
+// ------------------------ HUGE PAGE ARENAS ------------------------
+
+// An arena is one big allocation that sorted lists, and the index structures made from them, are carved out of.
+// It is backed by huge pages when the OS can give them, so searches through a big list miss the TLB much less: a 2MB
+// page covers 512 times as much of the list as a 4KB page does.
+// When a page size can't be had, the arena falls back to the next smaller one: 1GB, then 2MB, then transparent huge
+// pages, then normal pages. 1GB and 2MB pages need pages reserved by the admin on linux (MAP_HUGETLB), and the lock
+// pages in memory privilege on windows (MEM_LARGE_PAGES), where there is only the one large page size.
+// An arena can be put on a NUMA node, and a list can be copied to an arena on each node, so threads search the copy in
+// their own node's memory instead of going across to another socket.
+
+enum PageMode
+{
+    PageMode_Small,        // normal pages. Transparent huge pages are turned off for the arena, so they don't sneak in.
+    PageMode_Transparent,  // normal pages, with linux asked to back them with transparent huge pages when it can (madvise)
+    PageMode_Huge2MB,
+    PageMode_Huge1GB,
+
+    PageMode_Count
+};
+
+static const char* c_pageModeNames[PageMode_Count] =
+{
+    "Small Pages",
+    "Transparent Huge Pages",
+    "2MB Huge Pages",
+    "1GB Huge Pages",
+};
+
+// arenas are rounded up to a multiple of this
+static const size_t c_pageModeSizes[PageMode_Count] =
+{
+    size_t(1) << 12,
+    size_t(1) << 21,
+    size_t(1) << 21,
+    size_t(1) << 30,
+};
+
+static const size_t c_maxNumaNodes = 64;
+
+#ifdef __linux__
+static const int c_mapHugeShift = 26;  // MAP_HUGE_SHIFT, where the log2 of the page size goes in the mmap flags
+static const int c_mpolBind = 2;       // MPOL_BIND, from numaif.h, which needs libnuma
+#endif
+
+inline size_t RoundUpTo(size_t value, size_t multiple)
+{
+    return (value + multiple - 1) / multiple * multiple;
+}
+
+#ifdef _WIN32
+// Large pages need the lock pages in memory privilege, which the user needs to have been given, and which then has to be turned on
+bool EnableLockMemoryPrivilege()
+{
+    HANDLE token = nullptr;
+    if (!OpenProcessToken(GetCurrentProcess(), TOKEN_ADJUST_PRIVILEGES | TOKEN_QUERY, &token))
+        return false;
+
+    TOKEN_PRIVILEGES privileges;
+    privileges.PrivilegeCount = 1;
+    privileges.Privileges[0].Attributes = SE_PRIVILEGE_ENABLED;
+    bool success = LookupPrivilegeValueA(nullptr, "SeLockMemoryPrivilege", &privileges.Privileges[0].Luid) &&
+        AdjustTokenPrivileges(token, FALSE, &privileges, 0, nullptr, nullptr) &&
+        GetLastError() == ERROR_SUCCESS;
+    CloseHandle(token);
+    return success;
+}
+#endif
+
+#ifdef __linux__
+// How many bytes of the mapping that address is in are backed by transparent huge pages, from /proc/self/smaps
+size_t TransparentHugePageBytes(const void* address)
+{
+    FILE* file = nullptr;
+    fopen_s(&file, "/proc/self/smaps", "r");
+    if (!file)
+        return 0;
+
+    char line[512];
+    bool inMapping = false;
+    size_t ret = 0;
+    while (fgets(line, sizeof(line), file))
+    {
+        unsigned long long begin, end;
+        if (sscanf(line, "%llx-%llx", &begin, &end) == 2)
+        {
+            inMapping = uintptr_t(address) >= begin && uintptr_t(address) < end;
+            continue;
+        }
+
+        size_t kiloBytes = 0;
+        if (inMapping && sscanf(line, "AnonHugePages: %zu kB", &kiloBytes) == 1)
+        {
+            ret = kiloBytes * 1024;
+            break;
+        }
+    }
+    fclose(file);
+    return ret;
+}
+#endif
+
+// How many NUMA nodes there are. On linux, nodes are counted up from node0 until one is missing.
+size_t NumNumaNodes()
+{
+#ifdef _WIN32
+    ULONG highestNode = 0;
+    if (!GetNumaHighestNodeNumber(&highestNode))
+        return 1;
+    return std::min(size_t(highestNode) + 1, c_maxNumaNodes);
+#elif defined(__linux__)
+    size_t count = 0;
+    char path[256];
+    struct stat info;
+    while (count < c_maxNumaNodes)
+    {
+        sprintf_s(path, "/sys/devices/system/node/node%zu", count);
+        if (stat(path, &info) != 0)
+            break;
+        count++;
+    }
+    return std::max(count, size_t(1));
+#else
+    return 1;
+#endif
+}
+
+// The NUMA node of the core the calling thread is running on right now
+size_t CurrentNumaNode()
+{
+#ifdef _WIN32
+    PROCESSOR_NUMBER processor;
+    GetCurrentProcessorNumberEx(&processor);
+    USHORT node = 0;
+    if (!GetNumaProcessorNodeEx(&processor, &node))
+        return 0;
+    return node;
+#elif defined(__linux__)
+    unsigned int cpu = 0, node = 0;
+    if (syscall(SYS_getcpu, &cpu, &node, nullptr) != 0)
+        return 0;
+    return node;
+#else
+    return 0;
+#endif
+}
+
+class Arena
+{
+public:
+    Arena() {}
+    ~Arena() { Destroy(); }
+    Arena(const Arena&) = delete;
+    Arena& operator=(const Arena&) = delete;
+
+    // Reserves at least bytes, with pages as big as mode, or the biggest smaller pages the OS will give.
+    // numaNode is the node to put the memory on, or -1 to leave it up to the OS.
+    bool Create(size_t bytes, PageMode mode, int numaNode)
+    {
+        Destroy();
+        bytes = std::max(bytes, size_t(1));
+        for (int tryMode = mode; tryMode >= 0; --tryMode)
+        {
+            if (Map(bytes, PageMode(tryMode), numaNode))
+            {
+                m_pageMode = PageMode(tryMode);
+                return true;
+            }
+        }
+        return false;
+    }
+
+    void Destroy()
+    {
+        if (m_mapping)
+        {
+#ifdef _WIN32
+            VirtualFree(m_mapping, 0, MEM_RELEASE);
+#else
+            munmap(m_mapping, m_mappingBytes);
+#endif
+        }
+        m_mapping = nullptr;
+        m_mappingBytes = 0;
+        m_base = nullptr;
+        m_size = 0;
+        m_used = 0;
+        m_pageMode = PageMode_Small;
+    }
+
+    // Returns memory for count Ts, starting on a cache line, or nullptr if the arena doesn't have room
+    template <typename T>
+    T* Allocate(size_t count)
+    {
+        size_t begin = RoundUpTo(m_used, 64);
+        if (begin > m_size || count > (m_size - begin) / sizeof(T))
+            return nullptr;
+        m_used = begin + count * sizeof(T);
+        return (T*)(m_base + begin);
+    }
+
+    PageMode GetPageMode() const { return m_pageMode; }
+    const void* Base() const { return m_base; }
+    size_t Size() const { return m_size; }
+
+private:
+    bool Map(size_t bytes, PageMode mode, int numaNode)
+    {
+#ifdef _WIN32
+        // windows has no transparent huge pages, and only one large page size without VirtualAlloc2, which 2MB asks for
+        if (mode == PageMode_Transparent || mode == PageMode_Huge1GB)
+            return false;
+
+        DWORD flags = MEM_RESERVE | MEM_COMMIT;
+        size_t pageSize = c_pageModeSizes[PageMode_Small];
+        if (mode == PageMode_Huge2MB)
+        {
+            pageSize = GetLargePageMinimum();
+            if (pageSize == 0 || !EnableLockMemoryPrivilege())
+                return false;
+            flags |= MEM_LARGE_PAGES;
+        }
+
+        size_t mappingBytes = RoundUpTo(bytes, pageSize);
+        void* mapping = numaNode >= 0 ?
+            VirtualAllocExNuma(GetCurrentProcess(), nullptr, mappingBytes, flags, PAGE_READWRITE, DWORD(numaNode)) :
+            VirtualAlloc(nullptr, mappingBytes, flags, PAGE_READWRITE);
+        if (!mapping)
+            return false;
+
+        m_mapping = mapping;
+        m_mappingBytes = mappingBytes;
+        m_base = (char*)mapping;
+        m_size = mappingBytes;
+        return true;
+#else
+        size_t pageSize = c_pageModeSizes[mode];
+        size_t size = RoundUpTo(bytes, pageSize);
+        size_t mappingBytes = size;
+        int flags = MAP_PRIVATE | MAP_ANONYMOUS;
+        if (mode == PageMode_Huge2MB || mode == PageMode_Huge1GB)
+        {
+#if defined(__linux__) && defined(MAP_HUGETLB)
+            flags |= MAP_HUGETLB | ((mode == PageMode_Huge1GB ? 30 : 21) << c_mapHugeShift);
+#else
+            return false;
+#endif
+        }
+        else if (mode == PageMode_Transparent)
+        {
+#ifdef MADV_HUGEPAGE
+            // room to move the start up to a huge page boundary, so the arena is whole huge pages
+            mappingBytes += pageSize;
+#else
+            return false;
+#endif
+        }
+
+        void* mapping = mmap(nullptr, mappingBytes, PROT_READ | PROT_WRITE, flags, -1, 0);
+        if (mapping == MAP_FAILED)
+            return false;
+
+        char* base = (char*)mapping;
+#ifdef MADV_HUGEPAGE
+        if (mode == PageMode_Transparent)
+        {
+            base = (char*)RoundUpTo(size_t(mapping), pageSize);
+            madvise(base, size, MADV_HUGEPAGE);
+        }
+#endif
+#ifdef MADV_NOHUGEPAGE
+        if (mode == PageMode_Small)
+            madvise(mapping, mappingBytes, MADV_NOHUGEPAGE);
+#endif
+
+        // the pages aren't touched yet, so binding the range puts them on the node when they are.
+        // If it fails, the memory still works, it's just wherever the OS puts it.
+#ifdef __linux__
+        if (numaNode >= 0 && size_t(numaNode) < c_maxNumaNodes)
+        {
+            unsigned long nodeMask[c_maxNumaNodes / (sizeof(unsigned long) * 8)] = {};
+            nodeMask[numaNode / (sizeof(unsigned long) * 8)] |= 1ul << (numaNode % (sizeof(unsigned long) * 8));
+            // maxnode is one more than the number of bits of the mask the kernel reads
+            syscall(SYS_mbind, base, size, c_mpolBind, nodeMask, c_maxNumaNodes + 1, 0);
+        }
+#endif
+
+        m_mapping = mapping;
+        m_mappingBytes = mappingBytes;
+        m_base = base;
+        m_size = size;
+        return true;
+#endif
+    }
+
+    void* m_mapping = nullptr;  // what was mapped, to unmap it...
+    size_t m_mappingBytes = 0;  // ...and how big
+    char* m_base = nullptr;     // where allocations start, which is on a page boundary of the page size
+    size_t m_size = 0;
+    size_t m_used = 0;
+    PageMode m_pageMode = PageMode_Small;
+};
+
+// A sorted list copied into an arena, or into an arena on each NUMA node, optionally along with a layout made from it
+class ArenaList
+{
+public:
+    bool Create(const std::vector<size_t>& values, PageMode mode, bool replicatePerNode)
+    {
+        return Create(values, std::vector<size_t>(), mode, replicatePerNode);
+    }
+
+    // layout is made from values by one of the MakeLayout functions, or is empty to only copy the list
+    bool Create(const std::vector<size_t>& values, const std::vector<size_t>& layout, PageMode mode, bool replicatePerNode)
+    {
+        m_arenas.clear();
+        m_copies.clear();
+        m_layouts.clear();
+
+        // layouts pad themselves so their nodes start on a cache line, which depends on where they are in memory. The
+        // layout copy goes at the same place within a cache line as the layout, which takes up to a cache line more.
+        size_t layoutPadding = size_t(layout.data()) % 64 / sizeof(size_t);
+        size_t layoutBytes = layout.empty() ? 0 : 64 + (layoutPadding + layout.size()) * sizeof(size_t);
+
+        size_t numCopies = replicatePerNode ? NumNumaNodes() : 1;
+        for (size_t node = 0; node < numCopies; ++node)
+        {
+            std::unique_ptr<Arena> arena(new Arena);
+            if (!arena->Create(values.size() * sizeof(size_t) + layoutBytes, mode, replicatePerNode ? int(node) : -1))
+                return false;
+
+            size_t* copy = arena->Allocate<size_t>(values.size());
+            if (!values.empty())
+                memcpy(copy, values.data(), values.size() * sizeof(size_t));
+            m_copies.push_back(ArrayView<size_t>(copy, values.size()));
+
+            if (!layout.empty())
+            {
+                size_t* layoutCopy = arena->Allocate<size_t>(layoutPadding + layout.size()) + layoutPadding;
+                memcpy(layoutCopy, layout.data(), layout.size() * sizeof(size_t));
+                m_layouts.push_back(ArrayView<size_t>(layoutCopy, layout.size()));
+            }
+            m_arenas.push_back(std::move(arena));
+        }
+        return true;
+    }
+
+    // The copy on the node the calling thread is running on. Threads can be moved to other nodes, so this should be
+    // called again now and then, but it isn't free, so not for every search.
+    const ArrayView<size_t>& LocalCopy() const
+    {
+        return m_copies.size() > 1 ? m_copies[CurrentNumaNode() % m_copies.size()] : m_copies[0];
+    }
+
+    // The layout copy on the node the calling thread is running on. Only there if Create() was given a layout.
+    const ArrayView<size_t>& LocalLayout() const
+    {
+        return m_layouts.size() > 1 ? m_layouts[CurrentNumaNode() % m_layouts.size()] : m_layouts[0];
+    }
+
+    // the smallest page size any of the copies got
+    PageMode GetPageMode() const
+    {
+        PageMode mode = PageMode(PageMode_Count - 1);
+        for (const std::unique_ptr<Arena>& arena : m_arenas)
+            mode = std::min(mode, arena->GetPageMode());
+        return mode;
+    }
+
+    size_t NumCopies() const { return m_copies.size(); }
+    const Arena& GetArena(size_t index) const { return *m_arenas[index]; }
+
+private:
+    std::vector<std::unique_ptr<Arena>> m_arenas;
+    std::vector<ArrayView<size_t>> m_copies;
+    std::vector<ArrayView<size_t>> m_layouts;
+};
+
+// Checks results found in an arena copy against the neighbors of the index they found in the original list
+void HugePageTest_Verify(const std::vector<size_t>& list, const std::vector<size_t>& searchValues, const TestResults* results, const char* name)
+{
+    #if VERIFY_RESULT()
+    size_t failures = 0;
+    for (size_t searchIndex = 0; searchIndex < searchValues.size(); ++searchIndex)
+    {
+        size_t searchValue = searchValues[searchIndex];
+        const TestResults& ret = results[searchIndex];
+        if (ret.found ? list[ret.index] != searchValue :
+            (ret.index > 0 && list[ret.index - 1] > searchValue) || (ret.index + 1 < list.size() && list[ret.index + 1] < searchValue))
+            failures++;
+    }
+    if (failures > 0)
+        printf("VERIFICATION FAILURE!! %zu wrong results! %s\n", failures, name);
+    #endif
+}
+
+template <typename TKernel>
+void HugePageTest_Search(const ArrayView<size_t>& values, const std::vector<size_t>& list, const std::vector<size_t>& searchValues, std::vector<TestResults>& results)
+{
+    size_t guesses = 0;
+    std::chrono::high_resolution_clock::time_point start = std::chrono::high_resolution_clock::now();
+    for (size_t searchIndex = 0; searchIndex < searchValues.size(); ++searchIndex)
+    {
+        results[searchIndex] = TKernel::Search(values, searchValues[searchIndex]);
+        guesses += results[searchIndex].guesses;
+    }
+    std::chrono::high_resolution_clock::time_point end = std::chrono::high_resolution_clock::now();
+
+    double seconds = std::chrono::duration_cast<std::chrono::duration<double>>(end - start).count();
+    printf("    %s : %0.1f nanoseconds per search (%0.2f guesses per search)\n", TKernel::Name(),
+        seconds * 1000.0 * 1000.0 * 1000.0 / double(searchValues.size()), double(guesses) / double(searchValues.size()));
+    HugePageTest_Verify(list, searchValues, results.data(), TKernel::Name());
+}
+
+// Searches a list with all the threads, each searching the copy on its own node
+double HugePageTest_Parallel(WorkStealingPool& pool, const ArenaList& list, const std::vector<size_t>& searchValues, std::vector<TestResults>& results)
+{
+    size_t numChunks = (searchValues.size() + c_parallelSearchChunkSize - 1) / c_parallelSearchChunkSize;
+    std::atomic<size_t> guesses(0);
+
+    std::chrono::high_resolution_clock::time_point start = std::chrono::high_resolution_clock::now();
+    pool.ParallelFor(numChunks,
+        [&](size_t chunkIndex)
+        {
+            const ArrayView<size_t>& values = list.LocalCopy();
+            size_t begin = chunkIndex * c_parallelSearchChunkSize;
+            size_t end = std::min(begin + c_parallelSearchChunkSize, searchValues.size());
+            size_t chunkGuesses = 0;
+            for (size_t index = begin; index < end; ++index)
+            {
+                results[index] = Kernel_BranchlessBinarySearch::Search(values, searchValues[index]);
+                chunkGuesses += results[index].guesses;
+            }
+            guesses += chunkGuesses;
+        }
+    );
+    std::chrono::high_resolution_clock::time_point end = std::chrono::high_resolution_clock::now();
+    return std::chrono::duration_cast<std::chrono::duration<double>>(end - start).count();
+}
+
+void HugePageTest()
+{
+    static std::random_device rd("dev/random");
+    static std::seed_seq fullSeed{ rd(), rd(), rd(), rd(), rd(), rd(), rd(), rd() };
+    static std::mt19937 rng(fullSeed);
+
+    size_t maxValue = c_hugePageTestNumValues * 2;
+    std::vector<size_t> values, searchValues;
+    MakeList_Random(values, c_hugePageTestNumValues, maxValue, rng);
+    searchValues.resize(c_hugePageTestNumSearches);
+    std::uniform_int_distribution<size_t> dist(0, maxValue);
+    for (size_t& v : searchValues)
+        v = dist(rng);
+    std::vector<TestResults> results(searchValues.size());
+
+    // the B-tree layout goes in the arena with the list, so a layout search gets the huge pages too
+    std::vector<size_t> layout;
+    MakeLayout_BTree(values, layout);
+
+    printf("Random list of %zu values (%zu MB) and its B-tree layout (%zu MB) in an arena, by page size:\n", c_hugePageTestNumValues,
+        c_hugePageTestNumValues * sizeof(size_t) / (1024 * 1024), layout.size() * sizeof(size_t) / (1024 * 1024));
+    PageMode bestMode = PageMode_Small;
+    for (int mode = 0; mode < PageMode_Count; ++mode)
+    {
+        ArenaList list;
+        if (!list.Create(values, layout, PageMode(mode), false))
+        {
+            printf("  %s : could not make an arena\n", c_pageModeNames[mode]);
+            continue;
+        }
+
+        PageMode gotMode = list.GetPageMode();
+        bestMode = std::max(bestMode, gotMode);
+        if (gotMode != mode)
+            printf("  %s : fell back to %s\n", c_pageModeNames[mode], c_pageModeNames[gotMode]);
+        else
+            printf("  %s :\n", c_pageModeNames[mode]);
+
+        #ifdef __linux__
+        if (gotMode == PageMode_Transparent)
+        {
+            const Arena& arena = list.GetArena(0);
+            printf("    %zu MB of %zu MB got transparent huge pages\n", TransparentHugePageBytes(arena.Base()) / (1024 * 1024), arena.Size() / (1024 * 1024));
+        }
+        #endif
+
+        const ArrayView<size_t>& copy = list.LocalCopy();
+        HugePageTest_Search<Kernel_LineFit>(copy, values, searchValues, results);
+        HugePageTest_Search<Kernel_BinarySearch>(copy, values, searchValues, results);
+        HugePageTest_Search<Kernel_BranchlessBinarySearch>(copy, values, searchValues, results);
+        HugePageTest_Search<Kernel_HybridSearch>(copy, values, searchValues, results);
+        HugePageTest_Search<Kernel_BTree>(list.LocalLayout(), values, searchValues, results);
+    }
+
+    // one copy on whichever node the OS put it, against a copy on every node, with the biggest pages that could be had
+    size_t numThreads = std::max(size_t(std::thread::hardware_concurrency()), size_t(1));
+    WorkStealingPool pool(numThreads);
+    printf("  %zu threads on %zu NUMA nodes, %s, %s:\n", numThreads, NumNumaNodes(), c_pageModeNames[bestMode], Kernel_BranchlessBinarySearch::Name());
+    for (int replicate = 0; replicate < 2; ++replicate)
+    {
+        ArenaList list;
+        if (!list.Create(values, bestMode, replicate != 0))
+            continue;
+
+        double seconds = HugePageTest_Parallel(pool, list, searchValues, results);
+        printf("    %s : %0.2f M searches/s\n", replicate ? "A copy per node" : "One copy", double(searchValues.size()) / (seconds * 1000.0 * 1000.0));
+        HugePageTest_Verify(values, searchValues, results.data(), replicate ? "A copy per node" : "One copy");
+    }
+    printf("\n");
+}
+
+// ------------------------ STRING AND COMPOSITE KEYS ------------------------
+
+// The searches only work on integers, so lists of string keys and composite keys are searched through a prefix of
+// each key. A key is written out as bytes that sort the same way the keys do (big endian for integers), and its prefix
+// is made from the bytes after the ones every key in the list starts with. A key that sorts before another never has
+// a bigger prefix, so the prefixes are a sorted list of size_t that any of the search functions can search, and it's
+// much smaller than the keys, which are only read to tell apart keys with the same prefix.
+//
+// The bytes of a prefix are renumbered, so interpolation works on them. Strings of digits only use 10 of the 256 byte
+// values, which leaves big holes in the prefixes that line fit guesses wrong across. Each byte position gets a digit,
+// with a radix of how many different bytes the keys have there, plus one if some keys are too short to have a byte
+// there. The prefix is as many of these digits as fit in a size_t, so zero padded numbers make prefixes that are the
+// numbers themselves. A search key with a byte no key has at a position gets the digit of the next smaller byte that
+// keys do have there, and the biggest digits after it, so it sorts after those keys and before the ones with a bigger
+// byte. If no key has a smaller byte there, it gets the smallest digits from there on.
+//
+// The search function finds the prefix, galloping finds the run of keys that have it, and a binary search of the full
+// keys in that run finds the key.
+
+static const size_t c_maxKeyBytes = 64;  // keys are compared by at most this many bytes to find the bytes every key starts with
+
+// A composite key, sorted by tenant, and then by timestamp
+struct TenantKey
+{
+    uint32_t tenant;
+    uint64_t timestamp;
+
+    bool operator < (const TenantKey& other) const { return tenant != other.tenant ? tenant < other.tenant : timestamp < other.timestamp; }
+    bool operator == (const TenantKey& other) const { return tenant == other.tenant && timestamp == other.timestamp; }
+};
+
+// KeyBytes() points bytes at the bytes of a key, which sort like the keys do, using buffer if it needs to, and returns how many there are
+inline size_t KeyBytes(const std::string& key, unsigned char* buffer, const unsigned char*& bytes)
+{
+    bytes = (const unsigned char*)key.data();
+    return key.size();
+}
+
+inline size_t KeyBytes(const TenantKey& key, unsigned char* buffer, const unsigned char*& bytes)
+{
+    for (size_t index = 0; index < 4; ++index)
+        buffer[index] = (unsigned char)(key.tenant >> (24 - index * 8));
+    for (size_t index = 0; index < 8; ++index)
+        buffer[4 + index] = (unsigned char)(key.timestamp >> (56 - index * 8));
+    bytes = buffer;
+    return 12;
+}
+
+template <typename TKey>
+class PrefixKeyIndex
+{
+public:
+    // keys must be sorted, and stay alive and unchanged while the index is used
+    void Build(const std::vector<TKey>& keys)
+    {
+        m_keys = &keys;
+        m_commonBytes.clear();
+        m_digits.clear();
+        m_prefixes.resize(keys.size());
+        if (keys.empty())
+            return;
+
+        // the keys are sorted, so the bytes all of them start with are the bytes the first and last start with
+        unsigned char firstBuffer[c_maxKeyBytes], lastBuffer[c_maxKeyBytes];
+        const unsigned char* firstBytes;
+        const unsigned char* lastBytes;
+        size_t firstSize = KeyBytes(keys.front(), firstBuffer, firstBytes);
+        size_t lastSize = KeyBytes(keys.back(), lastBuffer, lastBytes);
+        size_t commonSize = 0;
+        while (commonSize < std::min(std::min(firstSize, lastSize), c_maxKeyBytes) && firstBytes[commonSize] == lastBytes[commonSize])
+            commonSize++;
+        m_commonBytes.assign(firstBytes, firstBytes + commonSize);
+
+        // which bytes the keys have at each position after the common bytes, and whether any key is too short to have one
+        size_t numPositions = c_maxKeyBytes - commonSize;
+        std::vector<std::array<bool, 256>> seen(numPositions);
+        std::vector<bool> seenShort(numPositions, false);
+        for (std::array<bool, 256>& seenBytes : seen)
+            seenBytes.fill(false);
+        for (const TKey& key : keys)
+        {
+            unsigned char buffer[c_maxKeyBytes];
+            const unsigned char* bytes;
+            size_t size = std::min(KeyBytes(key, buffer, bytes), c_maxKeyBytes);
+            for (size_t position = commonSize; position < size; ++position)
+                seen[position - commonSize][bytes[position]] = true;
+            if (size < c_maxKeyBytes)
+                seenShort[std::max(size, commonSize) - commonSize] = true;
+        }
+
+        // a digit for each position, until they don't fit in a size_t, or no key is long enough to have a byte there.
+        // A key that is too short at one position is too short at all the ones after it too.
+        size_t prefixRange = 1;
+        bool anyShort = false;
+        for (size_t position = 0; position < numPositions; ++position)
+        {
+            anyShort = anyShort || seenShort[position];
+            size_t shortCodes = anyShort ? 1 : 0;
+
+            PrefixDigit digit;
+            size_t numSeen = 0;
+            for (size_t byte = 0; byte < 256; ++byte)
+            {
+                numSeen += seen[position][byte] ? 1 : 0;
+                digit.codes[byte] = uint16_t(numSeen > 0 ? shortCodes + numSeen - 1 : 0);
+                digit.seen[byte] = seen[position][byte];
+                digit.belowAll[byte] = numSeen == 0;
+            }
+            digit.radix = shortCodes + numSeen;
+            if (numSeen == 0 || prefixRange > ~size_t(0) / digit.radix)
+                break;
+            prefixRange *= digit.radix;
+            m_digits.push_back(digit);
+        }
+
+        for (size_t index = 0; index < keys.size(); ++index)
+            m_prefixes[index] = Prefix(keys[index]);
+    }
+
+    // Returns the index of the key if it's there, or the index it would go at if it isn't, like LowerBoundToResults does.
+    // Reads of prefixes and comparisons of full keys both count as guesses.
+    TestResults Search(TestListFn searchFn, const TKey& searchKey) const
+    {
+        const std::vector<TKey>& keys = *m_keys;
+        if (keys.empty())
+        {
+            TestResults ret;
+            ret.found = false;
+            ret.index = 0;
+            ret.guesses = 0;
+            return ret;
+        }
+        size_t searchPrefix = Prefix(searchKey);
+
+        TestResults ret = searchFn(m_prefixes, searchPrefix);
+        size_t guesses = ret.guesses;
+
+        // the search function only has to land next to the prefix, or anywhere in a run of it, so gallop out to the ends of the run
+        size_t begin = ret.index;
+        size_t end = ret.index;
+        if (begin < m_prefixes.size())
+        {
+            guesses++;
+            if (m_prefixes[begin] < searchPrefix)
+                begin = end = begin + 1;
+        }
+        begin = GallopDown(begin, searchPrefix, guesses);
+        end = GallopUp(std::max(begin, end), searchPrefix, guesses);
+
+        // only the keys with the same prefix need their full keys compared
+        size_t lowerBound = std::lower_bound(keys.begin() + begin, keys.begin() + end, searchKey,
+            [&guesses](const TKey& a, const TKey& b) { guesses++; return a < b; }) - keys.begin();
+
+        ret.found = lowerBound < keys.size() && keys[lowerBound] == searchKey;
+        ret.index = (lowerBound == keys.size() && lowerBound > 0) ? lowerBound - 1 : lowerBound;
+        ret.guesses = guesses;
+        return ret;
+    }
+
+    const std::vector<size_t>& Prefixes() const { return m_prefixes; }
+    size_t CommonBytes() const { return m_commonBytes.size(); }
+    size_t PrefixBytes() const { return m_digits.size(); }
+
+private:
+    size_t Prefix(const TKey& key) const
+    {
+        unsigned char buffer[c_maxKeyBytes];
+        const unsigned char* bytes;
+        size_t size = KeyBytes(key, buffer, bytes);
+
+        // a search key that doesn't start with the common bytes sorts before or after every key
+        size_t compareSize = std::min(size, m_commonBytes.size());
+        int compare = compareSize > 0 ? memcmp(bytes, m_commonBytes.data(), compareSize) : 0;
+        if (compare < 0 || (compare == 0 && size < m_commonBytes.size()))
+            return 0;
+        if (compare > 0)
+            return ~size_t(0);
+
+        size_t prefix = 0;
+        bool biggestDigits = false;
+        bool smallestDigits = false;
+        for (size_t digitIndex = 0; digitIndex < m_digits.size(); ++digitIndex)
+        {
+            const PrefixDigit& digit = m_digits[digitIndex];
+            size_t position = m_commonBytes.size() + digitIndex;
+            size_t code = 0;
+            if (biggestDigits)
+            {
+                code = digit.radix - 1;
+            }
+            else if (!smallestDigits && position < size)
+            {
+                unsigned char byte = bytes[position];
+                code = digit.codes[byte];
+                smallestDigits = digit.belowAll[byte];
+                biggestDigits = !smallestDigits && !digit.seen[byte];
+            }
+            prefix = prefix * digit.radix + code;
+        }
+        return prefix;
+    }
+
+    struct PrefixDigit
+    {
+        uint16_t codes[256];  // the digit for each byte. If some keys are too short to have a byte here, 0 is for them.
+        bool seen[256];       // whether any key has this byte here
+        bool belowAll[256];   // whether this byte is smaller than any byte a key has here
+        size_t radix;
+    };
+
+    // Returns the first index at or before index with a prefix that isn't less than searchPrefix, when the prefix at
+    // index isn't (or index is the end). Steps down 1, 2, 4... and then binary searches the last step.
+    size_t GallopDown(size_t index, size_t searchPrefix, size_t& guesses) const
+    {
+        size_t step = 1;
+        while (index >= step)
+        {
+            guesses++;
+            if (m_prefixes[index - step] < searchPrefix)
+                return BinarySearchPrefixes(index - step + 1, index, searchPrefix, false, guesses);
+            index -= step;
+            step *= 2;
+        }
+        return BinarySearchPrefixes(0, index, searchPrefix, false, guesses);
+    }
+
+    // Returns the first index at or after index with a prefix bigger than searchPrefix, when the prefix before index isn't
+    size_t GallopUp(size_t index, size_t searchPrefix, size_t& guesses) const
+    {
+        size_t step = 1;
+        while (index + step <= m_prefixes.size())
+        {
+            guesses++;
+            if (m_prefixes[index + step - 1] > searchPrefix)
+                return BinarySearchPrefixes(index, index + step - 1, searchPrefix, true, guesses);
+            index += step;
+            step *= 2;
+        }
+        return BinarySearchPrefixes(index, m_prefixes.size(), searchPrefix, true, guesses);
+    }
+
+    // The first index in [begin, end) with a prefix that is bigger than (UPPER) or not less than searchPrefix, or end if there isn't one
+    size_t BinarySearchPrefixes(size_t begin, size_t end, size_t searchPrefix, bool upper, size_t& guesses) const
+    {
+        while (begin < end)
+        {
+            size_t mid = begin + (end - begin) / 2;
+            guesses++;
+            if (upper ? m_prefixes[mid] <= searchPrefix : m_prefixes[mid] < searchPrefix)
+                begin = mid + 1;
+            else
+                end = mid;
+        }
+        return begin;
+    }
+
+    const std::vector<TKey>* m_keys = nullptr;
+    std::vector<unsigned char> m_commonBytes;
+    std::vector<PrefixDigit> m_digits;
+    std::vector<size_t> m_prefixes;
+};
+
+// user ids, as "user/" and then a zero padded number, so they sort like the numbers do
+void MakeStringKeys_UserIds(std::vector<std::string>& keys, size_t count, std::mt19937& rng)
+{
+    std::uniform_int_distribution<size_t> dist(0, count * 1000);
+    keys.resize(count);
+    char buffer[64];
+    for (std::string& key : keys)
+    {
+        sprintf_s(buffer, "user/%012zu", dist(rng));
+        key = buffer;
+    }
+}
+
+// random lower case words from 1 to 16 letters long
+void MakeStringKeys_Words(std::vector<std::string>& keys, size_t count, std::mt19937& rng)
+{
+    std::uniform_int_distribution<size_t> lengthDist(1, 16);
+    std::uniform_int_distribution<int> letterDist('a', 'z');
+    keys.resize(count);
+    for (std::string& key : keys)
+    {
+        key.resize(lengthDist(rng));
+        for (char& c : key)
+            c = char(letterDist(rng));
+    }
+}
+
+// timestamps in nanoseconds, spread over a year, for c_stringKeyTestNumTenants tenants
+void MakeTenantKeys(std::vector<TenantKey>& keys, size_t count, std::mt19937& rng)
+{
+    static const uint64_t yearStart = 1700000000ull * 1000000000ull;
+    static const uint64_t yearLength = 365ull * 24ull * 60ull * 60ull * 1000000000ull;
+    std::uniform_int_distribution<uint32_t> tenantDist(0, c_stringKeyTestNumTenants - 1);
+    std::uniform_int_distribution<uint64_t> timestampDist(yearStart, yearStart + yearLength);
+    keys.resize(count);
+    for (TenantKey& key : keys)
+    {
+        key.tenant = tenantDist(rng);
+        key.timestamp = timestampDist(rng);
+    }
+}
+
+// Sorts the keys, and makes half of the search keys keys from the list. The other half are new keys made the same way.
+// Then times binary searching the full keys, and each search function searching the prefixes.
+template <typename TKey>
+void StringKeyTest_Search(const char* name, std::vector<TKey>& keys, std::vector<TKey>& searchKeys, const TestListInfo* testFns, size_t numTestFns, std::mt19937& rng)
+{
+    std::sort(keys.begin(), keys.end());
+    if (!keys.empty())
+    {
+        std::uniform_int_distribution<size_t> keyDist(0, keys.size() - 1);
+        for (size_t searchIndex = 0; searchIndex < searchKeys.size(); searchIndex += 2)
+            searchKeys[searchIndex] = keys[keyDist(rng)];
+    }
+
+    PrefixKeyIndex<TKey> index;
+    index.Build(keys);
+    const std::vector<size_t>& prefixes = index.Prefixes();
+    size_t numDifferentPrefixes = 0;
+    for (size_t prefixIndex = 0; prefixIndex < prefixes.size(); ++prefixIndex)
+        numDifferentPrefixes += (prefixIndex == 0 || prefixes[prefixIndex] != prefixes[prefixIndex - 1]) ? 1 : 0;
+    printf("  %s : every key starts with the same %zu bytes, the prefixes cover the %zu bytes after that, and %0.2f%% of them are different\n",
+        name, index.CommonBytes(), index.PrefixBytes(), 100.0 * double(numDifferentPrefixes) / double(std::max(prefixes.size(), size_t(1))));
+
+    size_t guesses = 0;
+    size_t indexSum = 0;
+    std::chrono::high_resolution_clock::time_point start = std::chrono::high_resolution_clock::now();
+    for (const TKey& searchKey : searchKeys)
+    {
+        indexSum += std::lower_bound(keys.begin(), keys.end(), searchKey,
+            [&guesses](const TKey& a, const TKey& b) { guesses++; return a < b; }) - keys.begin();
+    }
+    std::chrono::high_resolution_clock::time_point end = std::chrono::high_resolution_clock::now();
+    double seconds = std::chrono::duration_cast<std::chrono::duration<double>>(end - start).count();
+    printf("    Full Key Binary Search : %0.1f nanoseconds per search (%0.2f guesses per search)\n",
+        seconds * 1000.0 * 1000.0 * 1000.0 / double(searchKeys.size()), double(guesses) / double(searchKeys.size()));
+
+    for (size_t testIndex = 0; testIndex < numTestFns; ++testIndex)
+    {
+        // the layouts rearrange the prefixes, so the index they find isn't the index of the key.
+        // Linear search is O(n), which is far too slow for a list this size.
+        if (testFns[testIndex].layoutFn || testFns[testIndex].fn == TestList_LinearSearch<std::vector<size_t>>)
+            continue;
+
+        guesses = 0;
+        start = std::chrono::high_resolution_clock::now();
+        for (const TKey& searchKey : searchKeys)
+            guesses += index.Search(testFns[testIndex].fn, searchKey).guesses;
+        end = std::chrono::high_resolution_clock::now();
+        seconds = std::chrono::duration_cast<std::chrono::duration<double>>(end - start).count();
+
+        #if VERIFY_RESULT()
+        for (const TKey& searchKey : searchKeys)
+        {
+            TestResults ret = index.Search(testFns[testIndex].fn, searchKey);
+            size_t lowerBound = std::lower_bound(keys.begin(), keys.end(), searchKey) - keys.begin();
+            bool found = lowerBound < keys.size() && keys[lowerBound] == searchKey;
+            if (ret.found != found || ret.index != std::min(lowerBound, keys.size() - 1))
+            {
+                printf("VERIFICATION FAILURE!! Wrong result for a key! %s, %s\n", name, testFns[testIndex].name);
+                break;
+            }
+        }
+        #endif
+
+        printf("    %s : %0.1f nanoseconds per search (%0.2f guesses per search)\n", testFns[testIndex].name,
+            seconds * 1000.0 * 1000.0 * 1000.0 / double(searchKeys.size()), double(guesses) / double(searchKeys.size()));
+    }
+
+    // so the full key binary search isn't optimized away
+    if (indexSum == ~size_t(0))
+        printf("\n");
+}
+
+void StringKeyTest(const TestListInfo* testFns, size_t numTestFns)
+{
+    static std::random_device rd("dev/random");
+    static std::seed_seq fullSeed{ rd(), rd(), rd(), rd(), rd(), rd(), rd(), rd() };
+    static std::mt19937 rng(fullSeed);
+
+    printf("String and composite keys, %zu keys, searched through integer prefixes:\n", c_stringKeyTestNumKeys);
+    {
+        std::vector<std::string> keys, searchKeys;
+        MakeStringKeys_UserIds(keys, c_stringKeyTestNumKeys, rng);
+        MakeStringKeys_UserIds(searchKeys, c_stringKeyTestNumSearches, rng);
+        StringKeyTest_Search("User Ids", keys, searchKeys, testFns, numTestFns, rng);
+    }
+    {
+        std::vector<std::string> keys, searchKeys;
+        MakeStringKeys_Words(keys, c_stringKeyTestNumKeys, rng);
+        MakeStringKeys_Words(searchKeys, c_stringKeyTestNumSearches, rng);
+        StringKeyTest_Search("Words", keys, searchKeys, testFns, numTestFns, rng);
+    }
+    {
+        std::vector<TenantKey> keys, searchKeys;
+        MakeTenantKeys(keys, c_stringKeyTestNumKeys, rng);
+        MakeTenantKeys(searchKeys, c_stringKeyTestNumSearches, rng);
+        StringKeyTest_Search("Tenant Timestamps", keys, searchKeys, testFns, numTestFns, rng);
+    }
+    printf("\n");
+}
+
+// ------------------------ COMPRESSED LISTS ------------------------
+
+// A sorted list stored in blocks of c_compressedBlockSize values, which takes much less memory than a size_t per value
+// when the values are close together. Each block stores its values as bit packed offsets from its first value (frame of
+// reference), or as bit packed differences from the value before (delta), whichever needs fewer bits per value.
+// The first value of each block goes in a directory, which is an uncompressed sorted list.
+//
+// A search does an exact lower bound search of the directory, for the last block that starts with a value less than the
+// search value, and then unpacks just that block, counting how many of its values are less than the search
+// value. With AVX2, 8 values are unpacked at once, by gathering the 4 bytes each one is in and shifting it into place.
+// Like the branchless searches, this finds the lower bound, which is the index binary search finds for values that are in
+// the list without duplicates. Reading the block counts as one guess.
+//
+// The directory is searched with line fit, or with hybrid for lists that are too skewed for line fit on its own. Line fit
+// on the directory of a zipf list takes thousands of guesses, because most of the blocks start with the same few values.
+
+static const size_t c_compressedMaxSimdBits = 25;                // a packed value is in 4 bytes it can be gathered from if it is at most this many bits
+static const size_t c_compressedMaxSimdOffset = 0x7FFFFFFE;      // AVX2 compares are signed, so the offsets from the first value have to fit in 31 bits
+
+enum BlockEncoding : uint8_t
+{
+    BlockEncoding_FrameOfReference,  // each value minus the first value of the block
+    BlockEncoding_Delta,             // each value minus the value before it. The first one is 0.
+};
+
+struct CompressedBlock
+{
+    uint32_t wordOffset;  // where the packed values of the block start in the words of the list
+    uint8_t bits;         // how many bits each packed value has. 0 when every value of the block is the same.
+    uint8_t encoding;     // a BlockEncoding
+    bool simd;            // whether the block can be unpacked with AVX2
+};
+
+// how many bits it takes to hold a value
+inline size_t BitWidth(uint64_t value)
+{
+    if (value == 0)
+        return 0;
+#ifdef _MSC_VER
+    unsigned long index;
+    _BitScanReverse64(&index, value);
+    return index + 1;
+#else
+    return 64 - __builtin_clzll(value);
+#endif
+}
+
+// the packed value at an index, of values that are bits long
+inline uint64_t UnpackBits(const uint64_t* words, size_t index, size_t bits)
+{
+    if (bits == 0)
+        return 0;
+    size_t bitPosition = index * bits;
+    size_t shift = bitPosition % 64;
+    uint64_t value = words[bitPosition / 64] >> shift;
+    if (shift + bits > 64)
+        value |= words[bitPosition / 64 + 1] << (64 - shift);
+    return bits == 64 ? value : value & ((uint64_t(1) << bits) - 1);
+}
+
+// How many of the count packed values are less than key, and whether any are equal to it. The values are offsets from
+// the first value of the block, or differences which are added up into offsets, in 32 bit lanes.
+TARGET_AVX2 size_t CompressedBlockCountLess_AVX2(const uint64_t* words, size_t bits, bool delta, size_t count, uint32_t key, bool& found)
+{
+    const __m256i laneIndices = _mm256_setr_epi32(0, 1, 2, 3, 4, 5, 6, 7);
+    const __m256i bitsPerValue = _mm256_set1_epi32(int(bits));
+    const __m256i valueMask = _mm256_set1_epi32(int((uint32_t(1) << bits) - 1));
+    const __m256i keys = _mm256_set1_epi32(int(key));
+    const __m256i counts = _mm256_set1_epi32(int(count));
+
+    __m256i previous = _mm256_setzero_si256();  // the last offset of the 8 before, in every lane
+    size_t lessCount = 0;
+    int equalMask = 0;
+    for (size_t index = 0; index < count; index += 8)
+    {
+        __m256i indices = _mm256_add_epi32(_mm256_set1_epi32(int(index)), laneIndices);
+        __m256i bitPositions = _mm256_mullo_epi32(indices, bitsPerValue);
+        __m256i gathered = _mm256_i32gather_epi32((const int*)words, _mm256_srli_epi32(bitPositions, 3), 1);
+        __m256i values = _mm256_and_si256(_mm256_srlv_epi32(gathered, _mm256_and_si256(bitPositions, _mm256_set1_epi32(7))), valueMask);
+
+        // add up the differences: within each 128 bit half, then the total of the low half onto the high half
+        if (delta)
+        {
+            values = _mm256_add_epi32(values, _mm256_slli_si256(values, 4));
+            values = _mm256_add_epi32(values, _mm256_slli_si256(values, 8));
+            values = _mm256_add_epi32(values, _mm256_blend_epi32(_mm256_setzero_si256(), _mm256_permutevar8x32_epi32(values, _mm256_set1_epi32(3)), 0xF0));
+            values = _mm256_add_epi32(values, previous);
+            previous = _mm256_permutevar8x32_epi32(values, _mm256_set1_epi32(7));
+        }
+
+        // the lanes past the end of a short last block are left out
+        __m256i valid = _mm256_cmpgt_epi32(counts, indices);
+        int lessMask = _mm256_movemask_ps(_mm256_castsi256_ps(_mm256_and_si256(_mm256_cmpgt_epi32(keys, values), valid)));
+        equalMask |= _mm256_movemask_ps(_mm256_castsi256_ps(_mm256_and_si256(_mm256_cmpeq_epi32(keys, values), valid)));
+        lessCount += c_popCount4[lessMask & 15] + c_popCount4[lessMask >> 4];
+    }
+
+    found = equalMask != 0;
+    return lessCount;
+}
+
+class CompressedList
+{
+public:
+    void Build(const std::vector<size_t>& values)
+    {
+        m_numValues = values.size();
+        m_blockFirstValues.clear();
+        m_blocks.clear();
+        m_words.clear();
+
+        for (size_t begin = 0; begin < values.size(); begin += c_compressedBlockSize)
+        {
+            size_t end = std::min(begin + c_compressedBlockSize, values.size());
+            size_t first = values[begin];
+            size_t range = values[end - 1] - first;
+            size_t maxDifference = 0;
+            for (size_t index = begin + 1; index < end; ++index)
+                maxDifference = std::max(maxDifference, values[index] - values[index - 1]);
+
+            CompressedBlock block;
+            block.wordOffset = uint32_t(m_words.size());
+            block.encoding = BitWidth(maxDifference) < BitWidth(range) ? BlockEncoding_Delta : BlockEncoding_FrameOfReference;
+            block.bits = uint8_t(BitWidth(block.encoding == BlockEncoding_Delta ? maxDifference : range));
+            block.simd = block.bits <= c_compressedMaxSimdBits && range <= c_compressedMaxSimdOffset;
+
+            // blocks of all the same value don't take any words
+            size_t bits = block.bits;
+            m_words.resize(m_words.size() + ((end - begin) * bits + 63) / 64, 0);
+            uint64_t* words = m_words.data() + block.wordOffset;
+            for (size_t index = begin; bits > 0 && index < end; ++index)
+            {
+                uint64_t packed = block.encoding == BlockEncoding_Delta
+                    ? (index == begin ? 0 : values[index] - values[index - 1])
+                    : values[index] - first;
+                size_t bitPosition = (index - begin) * bits;
+                size_t shift = bitPosition % 64;
+                words[bitPosition / 64] |= packed << shift;
+                if (shift + bits > 64)
+                    words[bitPosition / 64 + 1] |= packed >> (64 - shift);
+            }
+
+            m_blockFirstValues.push_back(first);
+            m_blocks.push_back(block);
+        }
+
+        // AVX2 unpacks a whole block's worth of values even for a short last block, so there is room after the end for that
+        m_words.resize(m_words.size() + c_compressedBlockSize * c_compressedMaxSimdBits / 64 + 1, 0);
+    }
+
+    template <BoundGuess GUESS>
+    TestResults Search(size_t searchValue) const
+    {
+        static const bool avx2 = GetCPUFeatures().avx2;
+
+        TestResults ret;
+        ret.found = false;
+        ret.index = 0;
+        ret.guesses = 0;
+        if (m_numValues == 0)
+            return ret;
+
+        // the number of blocks that start with a value less than the search value
+        size_t blockIndex = LowerBound<GUESS>(m_blockFirstValues, searchValue, ret.guesses);
+        if (blockIndex == 0)
+        {
+            ret.found = m_blockFirstValues[0] == searchValue;
+            ret.index = 0;
+            return ret;
+        }
+
+        // the lower bound is in the last of them, or is the first value of the next block if every value of it is less
+        blockIndex--;
+        ret.guesses++;
+        const CompressedBlock& block = m_blocks[blockIndex];
+        const uint64_t* words = m_words.data() + block.wordOffset;
+        size_t begin = blockIndex * c_compressedBlockSize;
+        size_t count = std::min(c_compressedBlockSize, m_numValues - begin);
+        size_t first = m_blockFirstValues[blockIndex];
+        bool delta = block.encoding == BlockEncoding_Delta;
+
+        bool found = false;
+        size_t lessCount = 0;
+        if (avx2 && block.simd)
+        {
+            uint32_t key = uint32_t(std::min(searchValue - first, size_t(c_compressedMaxSimdOffset + 1)));
+            lessCount = CompressedBlockCountLess_AVX2(words, block.bits, delta, count, key, found);
+        }
+        else
+        {
+            size_t value = first;
+            for (size_t index = 0; index < count; ++index)
+            {
+                uint64_t packed = UnpackBits(words, index, block.bits);
+                value = delta ? value + size_t(packed) : first + size_t(packed);
+                lessCount += (value < searchValue) ? 1 : 0;
+                found = found || value == searchValue;
+            }
+        }
+
+        ret.index = begin + lessCount;
+        if (lessCount < count)
+        {
+            ret.found = found;
+        }
+        else if (blockIndex + 1 < m_blocks.size())
+        {
+            // the directory search already read this
+            ret.found = m_blockFirstValues[blockIndex + 1] == searchValue;
+        }
+        else
+        {
+            ret.index = m_numValues - 1;
+        }
+        return ret;
+    }
+
+    // unpacks every value, to check that they come back the same
+    void Decode(std::vector<size_t>& values) const
+    {
+        values.resize(m_numValues);
+        for (size_t blockIndex = 0; blockIndex < m_blocks.size(); ++blockIndex)
+        {
+            const CompressedBlock& block = m_blocks[blockIndex];
+            size_t begin = blockIndex * c_compressedBlockSize;
+            size_t end = std::min(begin + c_compressedBlockSize, m_numValues);
+            size_t value = m_blockFirstValues[blockIndex];
+            for (size_t index = begin; index < end; ++index)
+            {
+                uint64_t packed = UnpackBits(m_words.data() + block.wordOffset, index - begin, block.bits);
+                value = block.encoding == BlockEncoding_Delta ? value + size_t(packed) : m_blockFirstValues[blockIndex] + size_t(packed);
+                values[index] = value;
+            }
+        }
+    }
+
+    size_t MemoryBytes() const
+    {
+        return m_blockFirstValues.size() * sizeof(size_t) + m_blocks.size() * sizeof(CompressedBlock) + m_words.size() * sizeof(uint64_t);
+    }
+
+    size_t NumBlocks() const { return m_blocks.size(); }
+    const CompressedBlock& GetBlock(size_t index) const { return m_blocks[index]; }
+
+private:
+    size_t m_numValues = 0;
+    std::vector<size_t> m_blockFirstValues;  // the directory of blocks
+    std::vector<CompressedBlock> m_blocks;
+    std::vector<uint64_t> m_words;           // the packed values of every block
+};
+
+template <typename TSearch>
+void CompressedListTest_Time(const char* name, const std::vector<size_t>& searchValues, const TSearch& search)
+{
+    size_t guesses = 0;
+    std::chrono::high_resolution_clock::time_point start = std::chrono::high_resolution_clock::now();
+    for (size_t searchValue : searchValues)
+        guesses += search(searchValue).guesses;
+    std::chrono::high_resolution_clock::time_point end = std::chrono::high_resolution_clock::now();
+
+    double seconds = std::chrono::duration_cast<std::chrono::duration<double>>(end - start).count();
+    printf("    %s : %0.1f nanoseconds per search (%0.2f guesses per search)\n", name,
+        seconds * 1000.0 * 1000.0 * 1000.0 / double(searchValues.size()), double(guesses) / double(searchValues.size()));
+}
+
+void CompressedListTest(const MakeListInfo* makeFns, size_t numMakeFns)
+{
+    static std::random_device rd("dev/random");
+    static std::seed_seq fullSeed{ rd(), rd(), rd(), rd(), rd(), rd(), rd(), rd() };
+    static std::mt19937 rng(fullSeed);
+
+    size_t maxValue = c_compressedTestNumValues * 2;
+    std::vector<size_t> values, decoded, searchValues(c_compressedTestNumSearches);
+
+    printf("Compressed lists of %zu values (%zu MB uncompressed), in blocks of %zu:\n", c_compressedTestNumValues,
+        c_compressedTestNumValues * sizeof(size_t) / (1024 * 1024), c_compressedBlockSize);
+    for (size_t makeIndex = 0; makeIndex < numMakeFns; ++makeIndex)
+    {
+        const char* name = makeFns[makeIndex].name;
+        makeFns[makeIndex].fn(values, c_compressedTestNumValues, maxValue, rng);
+
+        // half the search values are from the list, and half are anywhere up to the biggest value
+        std::uniform_int_distribution<size_t> indexDist(0, values.size() - 1);
+        std::uniform_int_distribution<size_t> valueDist(0, values.back());
+        for (size_t searchIndex = 0; searchIndex < searchValues.size(); ++searchIndex)
+            searchValues[searchIndex] = (searchIndex % 2 == 0) ? values[indexDist(rng)] : valueDist(rng);
+
+        CompressedList list;
+        list.Build(values);
+        list.Decode(decoded);
+        if (decoded != values)
+            printf("VERIFICATION FAILURE!! Compressed list didn't decode to the same values! %s\n", name);
+
+        size_t numDelta = 0, numSimd = 0;
+        for (size_t blockIndex = 0; blockIndex < list.NumBlocks(); ++blockIndex)
+        {
+            numDelta += (list.GetBlock(blockIndex).encoding == BlockEncoding_Delta) ? 1 : 0;
+            numSimd += list.GetBlock(blockIndex).simd ? 1 : 0;
+        }
+        size_t rawBytes = values.size() * sizeof(size_t);
+        printf("  %s : %0.2f bits per value, %0.1fx smaller, %0.1f%% of blocks delta encoded, %0.1f%% of blocks can be unpacked with AVX2\n", name,
+            double(list.MemoryBytes()) * 8.0 / double(values.size()), double(rawBytes) / double(list.MemoryBytes()),
+            100.0 * double(numDelta) / double(list.NumBlocks()), 100.0 * double(numSimd) / double(list.NumBlocks()));
+
+        CompressedListTest_Time("Binary Search", searchValues,
+            [&](size_t searchValue) { return TestList_BinarySearch(values, searchValue); });
+        CompressedListTest_Time("Hybrid Integer", searchValues,
+            [&](size_t searchValue) { return TestList_HybridSearchInteger(values, searchValue); });
+        CompressedListTest_Time("Compressed Line Fit", searchValues,
+            [&](size_t searchValue) { return list.Search<BoundGuess_LineFit>(searchValue); });
+        CompressedListTest_Time("Compressed Hybrid", searchValues,
+            [&](size_t searchValue) { return list.Search<BoundGuess_Hybrid>(searchValue); });
+
+        // binary search finds the same thing, though with duplicates it can find a later copy, and for values that
+        // aren't in the list it can stop one before the lower bound
+        #if VERIFY_RESULT()
+        size_t failures = 0;
+        for (size_t searchValue : searchValues)
+        {
+            TestResults expected = TestList_BinarySearch(values, searchValue);
+            size_t lowerBound = std::lower_bound(values.begin(), values.end(), searchValue) - values.begin();
+            TestResults results[2] = { list.Search<BoundGuess_LineFit>(searchValue), list.Search<BoundGuess_Hybrid>(searchValue) };
+            for (const TestResults& ret : results)
+            {
+                if (ret.found != expected.found || ret.index != std::min(lowerBound, values.size() - 1) ||
+                    (ret.found && values[ret.index] != values[expected.index]))
+                    failures++;
+            }
+        }
+        if (failures > 0)
+            printf("VERIFICATION FAILURE!! %zu wrong results! %s, Compressed\n", failures, name);
+        #endif
+    }
+    printf("\n");
+}
+
+// ------------------------ RESULT WRITERS ------------------------
+
+// Writes a table of numbers to a file a row at a time, as the rows are finished, instead of keeping the whole table in
+// memory until the end. Rows are formatted into a buffer that is reused, and written to the file when it fills up.
+//
+// As a csv, each cell is quoted and followed by a comma, like the csvs have always been.
+// As binary, the file is a ResultFileHeader, then the column names (each null terminated), then the rows starting at
+// dataOffset, each row being numColumns doubles. It can be loaded without any parsing, for example in python with
+// numpy.fromfile(file, dtype=numpy.float64, offset=dataOffset).reshape(-1, numColumns), where column i is [:, i].
+
+struct ResultFileHeader
+{
+    char magic[4];          // "LFSR"
+    uint32_t version;
+    uint32_t numColumns;
+    uint32_t namesBytes;    // how many bytes of column names are right after the header
+    uint64_t dataOffset;    // where the rows start. 8 byte aligned.
+    uint64_t numRows;       // filled in when the file is closed
+};
+
+static const uint32_t c_resultFileVersion = 1;
+
+enum ResultColumnFormat
+{
+    ResultColumn_Integer,   // written to csvs like %zu
+    ResultColumn_Real,      // written to csvs like %f
+};
+
+class ResultWriter
+{
+public:
+    ResultWriter() : m_file(nullptr), m_binary(false), m_bufferUsed(0), m_numRows(0) {}
+    ~ResultWriter() { Close(); }
+
+    ResultWriter(const ResultWriter&) = delete;
+    ResultWriter& operator=(const ResultWriter&) = delete;
+
+    // Opens fileName plus .csv or .bin, and writes the column names
+    bool Open(const char* fileName, bool binary, const std::vector<std::string>& columnNames, const std::vector<ResultColumnFormat>& columnFormats)
+    {
+        Close();
+
+        char fullFileName[256];
+        sprintf_s(fullFileName, "%s.%s", fileName, binary ? "bin" : "csv");
+        fopen_s(&m_file, fullFileName, "w+b");
+        if (!m_file)
+        {
+            printf("Could not open %s for writing!\n", fullFileName);
+            return false;
+        }
+
+        m_binary = binary;
+        m_columnFormats = columnFormats;
+        m_buffer.resize(c_resultWriterBufferSize);
+        m_bufferUsed = 0;
+        m_numRows = 0;
+
+        if (m_binary)
+        {
+            // the header gets written again with the row count when the file is closed
+            ResultFileHeader header = MakeHeader(columnNames);
+            Append(&header, sizeof(header));
+            for (const std::string& name : columnNames)
+                Append(name.c_str(), name.size() + 1);
+            static const char c_zeros[8] = {};
+            Append(c_zeros, size_t(header.dataOffset) - sizeof(header) - header.namesBytes);
+        }
+        else
+        {
+            for (const std::string& name : columnNames)
+                AppendCell("%s", name.c_str());
+            Append("\n", 1);
+        }
+        return true;
+    }
+
+    // cells has a value for each column
+    void WriteRow(const double* cells)
+    {
+        if (m_binary)
+            Append(cells, m_columnFormats.size() * sizeof(double));
+        else
+        {
+            for (size_t columnIndex = 0; columnIndex < m_columnFormats.size(); ++columnIndex)
+            {
+                if (m_columnFormats[columnIndex] == ResultColumn_Integer)
+                    AppendCell("%zu", size_t(cells[columnIndex]));
+                else
+                    AppendCell("%f", cells[columnIndex]);
+            }
+            Append("\n", 1);
+        }
+        m_numRows++;
+    }
+
+    // writes the buffered rows to the file, so they can be seen before the file is closed
+    void Flush()
+    {
+        if (m_file && m_bufferUsed > 0)
+        {
+            fwrite(m_buffer.data(), 1, m_bufferUsed, m_file);
+            fflush(m_file);
+        }
+        m_bufferUsed = 0;
+    }
+
+    void Close()
+    {
+        if (!m_file)
+            return;
+
+        Flush();
+        if (m_binary)
+        {
+            ResultFileHeader header;
+            fseek(m_file, 0, SEEK_SET);
+            if (fread(&header, sizeof(header), 1, m_file) == 1)
+            {
+                header.numRows = m_numRows;
+                fseek(m_file, 0, SEEK_SET);
+                fwrite(&header, sizeof(header), 1, m_file);
+            }
+        }
+        fclose(m_file);
+        m_file = nullptr;
+    }
+
+private:
+    ResultFileHeader MakeHeader(const std::vector<std::string>& columnNames) const
+    {
+        ResultFileHeader header;
+        memcpy(header.magic, "LFSR", 4);
+        header.version = c_resultFileVersion;
+        header.numColumns = uint32_t(columnNames.size());
+        header.namesBytes = 0;
+        for (const std::string& name : columnNames)
+            header.namesBytes += uint32_t(name.size() + 1);
+        header.dataOffset = (uint64_t(sizeof(header)) + header.namesBytes + 7) & ~uint64_t(7);
+        header.numRows = 0;
+        return header;
+    }
+
+    void Append(const void* data, size_t size)
+    {
+        const char* bytes = (const char*)data;
+        while (size > 0)
+        {
+            if (m_bufferUsed == m_buffer.size())
+                Flush();
+            size_t copySize = std::min(size, m_buffer.size() - m_bufferUsed);
+            memcpy(&m_buffer[m_bufferUsed], bytes, copySize);
+            m_bufferUsed += copySize;
+            bytes += copySize;
+            size -= copySize;
+        }
+    }
+
+    // formats a quoted cell straight into the buffer, flushing first if it doesn't fit.
+    // A cell too big for even an empty buffer is formatted on its own, and appended in pieces.
+    template <typename T>
+    void AppendCell(const char* format, T value)
+    {
+        for (int attempt = 0; attempt < 2; ++attempt)
+        {
+            char* cell = &m_buffer[m_bufferUsed];
+            size_t space = m_buffer.size() - m_bufferUsed;
+            if (space > 3)
+            {
+                int length = snprintf(cell + 1, space - 1, format, value);
+                if (length >= 0 && size_t(length) + 3 <= space)
+                {
+                    cell[0] = '"';
+                    cell[length + 1] = '"';
+                    cell[length + 2] = ',';
+                    m_bufferUsed += size_t(length) + 3;
+                    return;
+                }
+            }
+            Flush();
+        }
+
+        int length = snprintf(nullptr, 0, format, value);
+        if (length < 0)
+        {
+            printf("Could not format a result cell!\n");
+            return;
+        }
+        std::vector<char> cell(size_t(length) + 3);
+        snprintf(&cell[1], size_t(length) + 1, format, value);
+        cell[0] = '"';
+        cell[length + 1] = '"';
+        cell[length + 2] = ',';
+        Append(cell.data(), cell.size());
+    }
+
+    FILE* m_file;
+    bool m_binary;
+    std::vector<ResultColumnFormat> m_columnFormats;
+    std::vector<char> m_buffer;
+    size_t m_bufferUsed;
+    uint64_t m_numRows;
+};
+
+// ------------------------ SIZE SWEEP ------------------------
+
+// The CSV sweep and the perf test use lists small enough to stay in L1 cache. This sweep doubles the list size from
+// 2^c_sizeSweepMinLog2 to 2^c_sizeSweepMaxLog2, to show how the searches do as the list falls out of each level of cache.
+// Each list (and layout) is made once per size. Searches are done in batches that double in size, until all
+// c_sizeSweepNumSearches are done or c_sizeSweepSecondsPerTest has passed, so the searches that become O(n) at large
+// sizes (linear search, line fit on the outlier list) don't take forever.
+
+void SizeSweep(const MakeListInfo* makeFns, size_t numMakeFns, const TestListInfo* testFns, size_t numTestFns)
+{
+    static std::random_device rd("dev/random");
+    static std::seed_seq fullSeed{ rd(), rd(), rd(), rd(), rd(), rd(), rd(), rd() };
+    static std::mt19937 rng(fullSeed);
+
+    // a file per list type, with a row per size, written as each size is done
+    char buffer[256];
+    std::vector<std::string> columnNames;
+    std::vector<ResultColumnFormat> columnFormats;
+    columnNames.push_back("Sample Count");
+    columnFormats.push_back(ResultColumn_Integer);
+    for (size_t testIndex = 0; testIndex < numTestFns; ++testIndex)
+    {
+        sprintf_s(buffer, "%s Searches Per Second", testFns[testIndex].name);
+        columnNames.push_back(buffer);
+        columnFormats.push_back(ResultColumn_Real);
+        sprintf_s(buffer, "%s Avg", testFns[testIndex].name);
+        columnNames.push_back(buffer);
+        columnFormats.push_back(ResultColumn_Real);
+    }
+
+    std::vector<ResultWriter> writers(numMakeFns);
+    for (size_t makeIndex = 0; makeIndex < numMakeFns; ++makeIndex)
+    {
+        sprintf_s(buffer, "out/Size Sweep %s", makeFns[makeIndex].name);
+        writers[makeIndex].Open(buffer, BINARY_RESULTS() != 0, columnNames, columnFormats);
+    }
+
+    std::vector<double> row(columnNames.size());
+    std::vector<size_t> values, layout, searchValues;
+    searchValues.resize(c_sizeSweepNumSearches);
+    for (size_t sizeLog2 = c_sizeSweepMinLog2; sizeLog2 <= c_sizeSweepMaxLog2; ++sizeLog2)
+    {
+        size_t numValues = size_t(1) << sizeLog2;
+        size_t maxValue = numValues * c_sizeSweepValueScale;
+
+        std::uniform_int_distribution<size_t> dist(0, maxValue);
+        for (size_t& v : searchValues)
+            v = dist(rng);
+
+        for (size_t makeIndex = 0; makeIndex < numMakeFns; ++makeIndex)
+        {
+            makeFns[makeIndex].fn(values, numValues, maxValue, rng);
+
+            row[0] = double(numValues);
+
+            for (size_t testIndex = 0; testIndex < numTestFns; ++testIndex)
+            {
+                if (testFns[testIndex].layoutFn)
+                    testFns[testIndex].layoutFn(values, layout);
+                const std::vector<size_t>& searchList = testFns[testIndex].layoutFn ? layout : values;
+
+                size_t numSearches = 0;
+                size_t guesses = 0;
+                double seconds = 0.0;
+                size_t batchSize = 1;
+                while (numSearches < searchValues.size() && seconds < c_sizeSweepSecondsPerTest)
+                {
+                    size_t batchEnd = std::min(numSearches + batchSize, searchValues.size());
+
+                    std::chrono::high_resolution_clock::time_point start = std::chrono::high_resolution_clock::now();
+
+                    for (; numSearches < batchEnd; ++numSearches)
+                    {
+                        TestResults ret = testFns[testIndex].fn(searchList, searchValues[numSearches]);
+                        guesses += ret.guesses;
+                    }
+
+                    std::chrono::high_resolution_clock::time_point end = std::chrono::high_resolution_clock::now();
+                    seconds += std::chrono::duration_cast<std::chrono::duration<double>>(end - start).count();
+
+                    batchSize *= 2;
+                }
+
+                row[1 + testIndex * 2] = seconds > 0.0 ? double(numSearches) / seconds : 0.0;
+                row[1 + testIndex * 2 + 1] = double(guesses) / double(numSearches);
+            }
+
+            writers[makeIndex].WriteRow(row.data());
+            writers[makeIndex].Flush();
+            printf("Size sweep: %s %zu values done\n", makeFns[makeIndex].name, numValues);
+        }
+    }
+}
+
+// ------------------------ MAIN ------------------------
+
+template <typename TValues>
+void VerifyResults(const TValues& values, typename TValues::value_type searchValue, const TestResults& result, const char* list, const char* test)
+{
+    #if VERIFY_RESULT()
+    // verify correctness of result by comparing to a linear search
+    TestResults actualResult = TestList_LinearSearch(values, searchValue);
+    if (result.found != actualResult.found)
+    {
+        printf("VERIFICATION FAILURE!! (found %s vs %s) %s, %s\n", result.found ? "true" : "false", actualResult.found ? "true" : "false", list, test);
+    }
+    else if (result.found == true && result.index != actualResult.index && values[result.index] != values[actualResult.index])
+    {
+        // Note that in the case of duplicates, different algorithms may return different indices, but the values stored in them should be the same
+        printf("VERIFICATION FAILURE!! (index %zu vs %zu) %s, %s\n", result.index, actualResult.index, list, test);
+    }
+    // verify that the index returned is a reasonable place for the value to be inserted, if the value was not found.
+    else if (result.found == false)
+    {
+        bool gte = true;
+        bool lte = true;
+
+        if (result.index > 0)
+            gte = searchValue >= values[result.index - 1];
+
+        if (result.index + 1 < values.size())
+            lte = searchValue <= values[result.index + 1];
+
+        if (gte == false || lte == false)
+            printf("VERIFICATION FAILURE!! Not a valid place to insert a new value! %s, %s\n", list, test);
+    }
+
+    #endif
+}
 
 int main(int argc, char** argv)
 {
     MakeListInfo MakeFns[] =
     {
-        {"Random", MakeList_Random},
-        {"Linear", MakeList_Linear},
-        {"Linear Outlier", MakeList_Linear_Outlier},
-        {"Quadratic", MakeList_Quadratic},
-        {"Cubic", MakeList_Cubic},
-        {"Log", MakeList_Log},
+        {"Random", MakeList_Random<size_t>},
+        {"Linear", MakeList_Linear<size_t>},
+        {"Linear Outlier", MakeList_Linear_Outlier<size_t>},
+        {"Quadratic", MakeList_Quadratic<size_t>},
+        {"Cubic", MakeList_Cubic<size_t>},
+        {"Log", MakeList_Log<size_t>},
+        {"Lognormal", MakeList_Lognormal<size_t>},
+        {"Zipf", MakeList_Zipf<size_t>},
+        {"Clustered", MakeList_Clustered<size_t>},
+        {"Timestamps", MakeList_Timestamps<size_t>},
+        {"Dense Outliers", MakeList_DenseOutliers<size_t>},
     };
 
     TestListInfo TestFns[] =
     {
-        {"Linear Search", TestList_LinearSearch},
-        {"Line Fit", TestList_LineFit},
-        {"Line Fit Blind", TestList_LineFitBlind},
-        {"Binary Search", TestList_BinarySearch},
-        {"Hybrid", TestList_HybridSearch},
+        {"Linear Search", TestList_LinearSearch<std::vector<size_t>>},
+        {"Line Fit", TestList_LineFit<std::vector<size_t>>},
+        {"Line Fit Blind", TestList_LineFitBlind<std::vector<size_t>>},
+        {"Binary Search", TestList_BinarySearch<std::vector<size_t>>},
+        {"Hybrid", TestList_HybridSearch<std::vector<size_t>>},
+        {"Line Fit Integer", TestList_LineFitInteger<std::vector<size_t>>},
+        {"Hybrid Integer", TestList_HybridSearchInteger<std::vector<size_t>>},
+        {"Adaptive", TestList_AdaptiveSearch<std::vector<size_t>>},
+        {"Branchless Binary Search", TestList_BranchlessBinarySearch<std::vector<size_t>>},
+        {"K-ary Search", TestList_KArySearch},
+        {"Fixed Size Branchless", TestList_FixedSizeBranchless},
+        {"Fixed Size", TestList_FixedSize},
+        {"Eytzinger", TestList_Eytzinger, MakeLayout_Eytzinger},
+        {"B-Tree", TestList_BTree<std::vector<size_t>>, MakeLayout_BTree},
+        {"Learned Index", TestList_LearnedIndex, MakeLayout_LearnedIndex},
+    };
+
+    TestListBatchInfo BatchTestFns[] =
+    {
+        {"Line Fit Batched", TestListBatch_Interleaved<LineFitSearchState<false>>},
+        {"Binary Search Batched", TestListBatch_Interleaved<BinarySearchState>},
+        {"Hybrid Batched", TestListBatch_Interleaved<LineFitSearchState<true>>},
+        {"Sorted Merge", TestListBatch_SortedMerge},
+    };
+
+    TestListHintedInfo HintedTestFns[] =
+    {
+        {"Line Fit Random Walk", TestListHinted_IgnoreHint<TestList_LineFit<std::vector<size_t>>>},
+        {"Line Fit Finger", TestListHinted_Finger<TestList_LineFit<ArrayView<size_t>>>},
+        {"Binary Search Random Walk", TestListHinted_IgnoreHint<TestList_BinarySearch<std::vector<size_t>>>},
+        {"Binary Search Finger", TestListHinted_Finger<TestList_BinarySearch<ArrayView<size_t>>>},
+        {"Hybrid Random Walk", TestListHinted_IgnoreHint<TestList_HybridSearch<std::vector<size_t>>>},
+        {"Hybrid Finger", TestListHinted_Finger<TestList_HybridSearch<ArrayView<size_t>>>},
+    };
+
+    TestListRangeInfo RangeTestFns[] =
+    {
+        {"Binary Search Range", TestListRange_Independent<BoundGuess_Binary>},
+        {"Binary Search Range Shared", TestListRange_Shared<BoundGuess_Binary>},
+        {"Line Fit Range", TestListRange_Independent<BoundGuess_LineFit>},
+        {"Line Fit Range Shared", TestListRange_Shared<BoundGuess_LineFit>},
+        {"Hybrid Range", TestListRange_Independent<BoundGuess_Hybrid>},
+        {"Hybrid Range Shared", TestListRange_Shared<BoundGuess_Hybrid>},
+    };
+
+    MakeSearchValuesInfo SearchValueFns[] =
+    {
+        {"Uniform", MakeSearchValues_Uniform},
+        {"Zipf", MakeSearchValues_Zipf},
+        {"Hot Set", MakeSearchValues_HotSet},
     };
 
 #if MAKE_CSVS()
 
-    size_t numThreads = std::thread::hardware_concurrency();
-    std::vector<std::thread> threads;
-    threads.resize(numThreads);
+    // The csvs are made by a grid of tasks, one per (list, test, list size), on the work stealing thread pool.
+    // Every random number comes from an rng seeded by c_csvSeed and the list and list size, so every test at a point
+    // searches the same list for the same values, and the csvs come out the same no matter how the tasks get scheduled.
+    // List sizes are done c_csvSizesPerBatch at a time, and their rows are written out as soon as the batch is done.
+    size_t numTestColumns = countof(TestFns) + countof(HintedTestFns);
+    size_t numColumns = 1 + numTestColumns * 4 + 1;
+    WorkStealingPool pool(std::max(size_t(std::thread::hardware_concurrency()), size_t(1)));
+    printf("Making csvs on %zu threads\n", pool.NumThreads());
+
+    // a row per sample count, after a row of titles
+    std::vector<std::string> columnNames;
+    std::vector<ResultColumnFormat> columnFormats;
+    {
+        char buffer[256];
+        columnNames.push_back("Sample Count");
+        columnFormats.push_back(ResultColumn_Integer);
+        for (size_t columnIndex = 0; columnIndex < numTestColumns; ++columnIndex)
+        {
+            const char* name = columnIndex < countof(TestFns) ? TestFns[columnIndex].name : HintedTestFns[columnIndex - countof(TestFns)].name;
+            sprintf_s(buffer, "%s Min", name);
+            columnNames.push_back(buffer);
+            sprintf_s(buffer, "%s Max", name);
+            columnNames.push_back(buffer);
+            sprintf_s(buffer, "%s Avg", name);
+            columnNames.push_back(buffer);
+            sprintf_s(buffer, "%s Single", name);
+            columnNames.push_back(buffer);
+            columnFormats.push_back(ResultColumn_Integer);
+            columnFormats.push_back(ResultColumn_Integer);
+            columnFormats.push_back(ResultColumn_Real);
+            columnFormats.push_back(ResultColumn_Integer);
+        }
+        columnNames.push_back("Sequence");
+        columnFormats.push_back(ResultColumn_Integer);
+    }
+
+    // the sequence column is the list at its biggest size
+    std::vector<ResultWriter> writers(countof(MakeFns));
+    std::vector<std::vector<size_t>> sequences(countof(MakeFns));
+    for (size_t makeIndex = 0; makeIndex < countof(MakeFns); ++makeIndex)
+    {
+        char fileName[256];
+        if (c_searchValueDistribution == 0)
+            sprintf_s(fileName, "out/%s", MakeFns[makeIndex].name);
+        else
+            sprintf_s(fileName, "out/%s %s", MakeFns[makeIndex].name, SearchValueFns[c_searchValueDistribution].name);
+        writers[makeIndex].Open(fileName, BINARY_RESULTS() != 0, columnNames, columnFormats);
+
+        std::seed_seq seed{ uint32_t(c_csvSeed), uint32_t(makeIndex), uint32_t(c_maxNumValues), uint32_t(0) };
+        std::mt19937 rng(seed);
+        MakeFns[makeIndex].fn(sequences[makeIndex], c_maxNumValues, c_maxValue, rng);
+    }
 
-    typedef std::vector<std::string> TRow;
-    typedef std::vector<TRow> TSheet;
+    // the lists and cells of the batch being worked on, reused from batch to batch
+    std::vector<std::vector<size_t>> lists(countof(MakeFns) * c_csvSizesPerBatch);
+    std::vector<double> cells(countof(MakeFns) * c_csvSizesPerBatch * numColumns);
 
-    // for each numer sequence. Done multithreadedly
-    std::atomic<size_t> nextRow(0);
-    for (std::thread& t : threads)
+    for (size_t batchStart = 1; batchStart <= c_maxNumValues; batchStart += c_csvSizesPerBatch)
     {
-        t = std::thread(
-            [&]()
+        size_t batchSize = std::min(c_csvSizesPerBatch, c_maxNumValues + 1 - batchStart);
+
+        // make the lists once per list size
+        pool.ParallelFor(countof(MakeFns) * batchSize,
+            [&](size_t taskIndex)
             {
-                size_t makeIndex = nextRow.fetch_add(1);
-                while (makeIndex < countof(MakeFns))
-                {
-                    printf("Starting %s\n", MakeFns[makeIndex].name);
+                size_t makeIndex = taskIndex / batchSize;
+                size_t numValues = batchStart + taskIndex % batchSize;
+                std::seed_seq seed{ uint32_t(c_csvSeed), uint32_t(makeIndex), uint32_t(numValues), uint32_t(0) };
+                std::mt19937 rng(seed);
+                MakeFns[makeIndex].fn(lists[taskIndex], numValues, c_maxValue, rng);
+            }
+        );
 
-                    static std::random_device rd("dev/random");
-                    static std::seed_seq fullSeed{ rd(), rd(), rd(), rd(), rd(), rd(), rd(), rd() };
-                    static std::mt19937 rng(fullSeed);
+        // Each task fills in its own four cells
+        pool.ParallelFor(countof(MakeFns) * numTestColumns * batchSize,
+            [&](size_t taskIndex)
+            {
+                size_t sizeIndex = taskIndex % batchSize;
+                size_t columnIndex = (taskIndex / batchSize) % numTestColumns;
+                size_t makeIndex = taskIndex / (batchSize * numTestColumns);
+                size_t numValues = batchStart + sizeIndex;
 
-                    // the data to write to the csv file. a row per sample count plus one more for titles
-                    TSheet csv;
-                    csv.resize(c_maxNumValues + 1);
+                std::seed_seq seed{ uint32_t(c_csvSeed), uint32_t(makeIndex), uint32_t(numValues), uint32_t(1) };
+                std::mt19937 rng(seed);
 
-                    // make a column for the sample counts
-                    char buffer[256];
-                    csv[0].push_back("Sample Count");
-                    for (size_t numValues = 1; numValues <= c_maxNumValues; ++numValues)
-                    {
-                        sprintf_s(buffer, "%zu", numValues);
-                        csv[numValues].push_back(buffer);
-                    }
+                const std::vector<size_t>& values = lists[makeIndex * batchSize + sizeIndex];
 
-                    // for each test
-                    std::vector<size_t> values;
-                    for (size_t testIndex = 0; testIndex < countof(TestFns); ++testIndex)
-                    {
-                        sprintf_s(buffer, "%s Min", TestFns[testIndex].name);
-                        csv[0].push_back(buffer);
-                        sprintf_s(buffer, "%s Max", TestFns[testIndex].name);
-                        csv[0].push_back(buffer);
-                        sprintf_s(buffer, "%s Avg", TestFns[testIndex].name);
-                        csv[0].push_back(buffer);
-                        sprintf_s(buffer, "%s Single", TestFns[testIndex].name);
-                        csv[0].push_back(buffer);
-
-                        // for each result
-                        for (size_t numValues = 1; numValues <= c_maxNumValues; ++numValues)
-                        {
-                            size_t guessMin = ~size_t(0);
-                            size_t guessMax = 0;
-                            float guessAverage = 0.0f;
-                            size_t guessSingle = 0;
-
-                            // repeat it a number of times to gather min, max, average
-                            for (size_t repeatIndex = 0; repeatIndex < c_numRunsPerTest; ++repeatIndex)
-                            {
-                                std::uniform_int_distribution<size_t> dist(0, c_maxValue);
-                                size_t searchValue = dist(rng);
-
-                                MakeFns[makeIndex].fn(values, numValues);
-                                TestResults result = TestFns[testIndex].fn(values, searchValue);
-
-                                VerifyResults(values, searchValue, result, MakeFns[makeIndex].name, TestFns[testIndex].name);
-
-                                guessMin = std::min(guessMin, result.guesses);
-                                guessMax = std::max(guessMax, result.guesses);
-                                guessAverage = Lerp(guessAverage, float(result.guesses), 1.0f / float(repeatIndex + 1));
-                                guessSingle = result.guesses;
-                            }
-
-                            sprintf_s(buffer, "%zu", guessMin);
-                            csv[numValues].push_back(buffer);
-
-                            sprintf_s(buffer, "%zu", guessMax);
-                            csv[numValues].push_back(buffer);
-
-                            sprintf_s(buffer, "%f", guessAverage);
-                            csv[numValues].push_back(buffer);
-
-                            sprintf_s(buffer, "%zu", guessSingle);
-                            csv[numValues].push_back(buffer);
-                        }
-                    }
+                size_t guessMin = ~size_t(0);
+                size_t guessMax = 0;
+                float guessAverage = 0.0f;
+                size_t guessSingle = 0;
 
-                    // make a column for the sampling sequence itself
-                    csv[0].push_back("Sequence");
-                    for (size_t numValues = 1; numValues <= c_maxNumValues; ++numValues)
-                    {
-                        sprintf_s(buffer, "%zu", values[numValues-1]);
-                        csv[numValues].push_back(buffer);
-                    }
+                if (columnIndex < countof(TestFns))
+                {
+                    const TestListInfo& test = TestFns[columnIndex];
 
-                    char fileName[256];
-                    sprintf_s(fileName, "out/%s.csv", MakeFns[makeIndex].name);
-                    FILE* file = nullptr;
-                    fopen_s(&file, fileName, "w+b");
+                    std::vector<size_t> layout, searchValues;
+                    if (test.layoutFn)
+                        test.layoutFn(values, layout);
+                    SearchValueFns[c_searchValueDistribution].fn(searchValues, c_numRunsPerTest, c_maxValue, rng);
 
-                    for (const TRow& row : csv)
+                    // repeat it a number of times to gather min, max, average
+                    for (size_t repeatIndex = 0; repeatIndex < c_numRunsPerTest; ++repeatIndex)
                     {
-                        for (const std::string& cell : row)
-                            fprintf(file, "\"%s\",", cell.c_str());
-                        fprintf(file, "\n");
+                        size_t searchValue = searchValues[repeatIndex];
+                        TestResults result = test.fn(test.layoutFn ? layout : values, searchValue);
+
+                        VerifyResults(values, searchValue, result, MakeFns[makeIndex].name, test.name);
+
+                        guessMin = std::min(guessMin, result.guesses);
+                        guessMax = std::max(guessMax, result.guesses);
+                        guessAverage = Lerp(guessAverage, float(result.guesses), 1.0f / float(repeatIndex + 1));
+                        guessSingle = result.guesses;
                     }
+                }
+                else
+                {
+                    // hinted tests search a random walk, with the index found by each search as the hint for the next
+                    const TestListHintedInfo& test = HintedTestFns[columnIndex - countof(TestFns)];
+
+                    std::vector<size_t> walkValues;
+                    MakeSearchValues_RandomWalk(walkValues, c_numRunsPerTest, c_maxValue, rng);
+                    size_t hintIndex = numValues / 2;
 
-                    fclose(file);
+                    for (size_t repeatIndex = 0; repeatIndex < c_numRunsPerTest; ++repeatIndex)
+                    {
+                        size_t searchValue = walkValues[repeatIndex];
+                        TestResults result = test.fn(values, searchValue, hintIndex);
+                        hintIndex = result.index;
 
-                    printf("Done with %s\n", MakeFns[makeIndex].name);
+                        VerifyResults(values, searchValue, result, MakeFns[makeIndex].name, test.name);
 
-                    makeIndex = nextRow.fetch_add(1);
+                        guessMin = std::min(guessMin, result.guesses);
+                        guessMax = std::max(guessMax, result.guesses);
+                        guessAverage = Lerp(guessAverage, float(result.guesses), 1.0f / float(repeatIndex + 1));
+                        guessSingle = result.guesses;
+                    }
                 }
+
+                double* row = &cells[(makeIndex * batchSize + sizeIndex) * numColumns];
+                row[1 + columnIndex * 4 + 0] = double(guessMin);
+                row[1 + columnIndex * 4 + 1] = double(guessMax);
+                row[1 + columnIndex * 4 + 2] = double(guessAverage);
+                row[1 + columnIndex * 4 + 3] = double(guessSingle);
             }
         );
+
+        // write out the batch's rows
+        for (size_t makeIndex = 0; makeIndex < countof(MakeFns); ++makeIndex)
+        {
+            for (size_t sizeIndex = 0; sizeIndex < batchSize; ++sizeIndex)
+            {
+                size_t numValues = batchStart + sizeIndex;
+                double* row = &cells[(makeIndex * batchSize + sizeIndex) * numColumns];
+                row[0] = double(numValues);
+                row[numColumns - 1] = double(sequences[makeIndex][numValues - 1]);
+                writers[makeIndex].WriteRow(row);
+            }
+            writers[makeIndex].Flush();
+        }
+        printf("csvs: %zu of %zu list sizes done\n", batchStart + batchSize - 1, c_maxNumValues);
     }
 
-    for (std::thread& t : threads)
-        t.join();
+    for (size_t makeIndex = 0; makeIndex < countof(MakeFns); ++makeIndex)
+    {
+        writers[makeIndex].Close();
+        printf("Done with %s\n", MakeFns[makeIndex].name);
+    }
 
 #endif // MAKE_CSVS()
 
@@ -606,16 +6561,16 @@ int main(int argc, char** argv)
         static std::seed_seq fullSeed{ rd(), rd(), rd(), rd(), rd(), rd(), rd(), rd() };
         static std::mt19937 rng(fullSeed);
 
-        std::vector<size_t> values, searchValues;
-        searchValues.resize(c_perfTestNumSearches);
+        std::vector<size_t> values, layout, searchValues;
         values.resize(c_maxNumValues);
 
         // make the search values that are going to be used by all the tests
-        {
-            std::uniform_int_distribution<size_t> dist(0, c_maxValue);
-            for (size_t & v : searchValues)
-                v = dist(rng);
-        }
+        printf("Perf test searching for %s search values\n\n", SearchValueFns[c_searchValueDistribution].name);
+        SearchValueFns[c_searchValueDistribution].fn(searchValues, c_perfTestNumSearches, c_maxValue, rng);
+
+        PerfCounters perfCounters;
+        if (!perfCounters.Available())
+            printf("Hardware performance counters are not available, only reporting time.\n\n");
 
         // binary search, linear search, etc
         for (size_t testIndex = 0; testIndex < countof(TestFns); ++testIndex)
@@ -625,33 +6580,231 @@ int main(int argc, char** argv)
             size_t totalGuesses = 0;
             for (size_t makeIndex = 0; makeIndex < countof(MakeFns); ++makeIndex)
             {
-                MakeFns[makeIndex].fn(values, c_maxNumValues);
+                MakeFns[makeIndex].fn(values, c_maxNumValues, c_maxValue, rng);
+
+                double layoutTime = 0.0;
+                if (TestFns[testIndex].layoutFn)
+                {
+                    std::chrono::high_resolution_clock::time_point layoutStart = std::chrono::high_resolution_clock::now();
+                    TestFns[testIndex].layoutFn(values, layout);
+                    std::chrono::high_resolution_clock::time_point layoutEnd = std::chrono::high_resolution_clock::now();
+                    layoutTime = std::chrono::duration_cast<std::chrono::duration<double>>(layoutEnd - layoutStart).count();
+                }
+                const std::vector<size_t>& searchList = TestFns[testIndex].layoutFn ? layout : values;
 
                 size_t guesses = 0;
 
+                perfCounters.Start();
                 std::chrono::high_resolution_clock::time_point start = std::chrono::high_resolution_clock::now();
 
                 // do the searches
                 for (size_t searchValue : searchValues)
                 {
-                    TestResults ret = TestFns[testIndex].fn(values, searchValue);
+                    TestResults ret = TestFns[testIndex].fn(searchList, searchValue);
                     guesses += ret.guesses;
                     totalGuesses += ret.guesses;
                 }
 
                 std::chrono::high_resolution_clock::time_point end = std::chrono::high_resolution_clock::now();
+                perfCounters.Stop();
 
                 std::chrono::duration<double> duration = std::chrono::duration_cast<std::chrono::duration<double>>(end - start);
 
                 timeTotal += duration.count();
-                printf("  %s %s : %f seconds\n", TestFns[testIndex].name, MakeFns[makeIndex].name, duration.count());
+                if (TestFns[testIndex].layoutFn)
+                {
+                    // report how long the layout took to make, and how much memory it uses beyond the sorted list it was made from
+                    size_t layoutBytes = layout.size() * sizeof(size_t);
+                    size_t valuesBytes = values.size() * sizeof(size_t);
+                    size_t extraBytes = layoutBytes > valuesBytes ? layoutBytes - valuesBytes : 0;
+                    printf("  %s %s : %f seconds (layout made in %f seconds, %zu bytes more than the sorted list)\n", TestFns[testIndex].name, MakeFns[makeIndex].name, duration.count(), layoutTime, extraBytes);
+                }
+                else
+                    printf("  %s %s : %f seconds\n", TestFns[testIndex].name, MakeFns[makeIndex].name, duration.count());
+
+                if (perfCounters.Available())
+                    perfCounters.PrintPerSearch(searchValues.size());
             }
 
             double timePerGuess = (timeTotal * 1000.0 * 1000.0 * 1000.0f) / double(totalGuesses);
             printf("%s total : %f seconds  (%zu guesses = %f nanoseconds per guess)\n\n", TestFns[testIndex].name, timeTotal, totalGuesses, timePerGuess);
         }
+
+        // batched searches, which work on all the search values at once instead of one at a time
+        std::vector<TestResults> batchResults;
+        batchResults.resize(c_perfTestNumSearches);
+        for (size_t testIndex = 0; testIndex < countof(BatchTestFns); ++testIndex)
+        {
+            double timeTotal = 0.0f;
+            size_t totalGuesses = 0;
+            for (size_t makeIndex = 0; makeIndex < countof(MakeFns); ++makeIndex)
+            {
+                MakeFns[makeIndex].fn(values, c_maxNumValues, c_maxValue, rng);
+
+                std::chrono::high_resolution_clock::time_point start = std::chrono::high_resolution_clock::now();
+
+                BatchTestFns[testIndex].fn(values, searchValues.data(), searchValues.size(), batchResults.data());
+
+                std::chrono::high_resolution_clock::time_point end = std::chrono::high_resolution_clock::now();
+
+                std::chrono::duration<double> duration = std::chrono::duration_cast<std::chrono::duration<double>>(end - start);
+
+                for (size_t searchIndex = 0; searchIndex < searchValues.size(); ++searchIndex)
+                {
+                    totalGuesses += batchResults[searchIndex].guesses;
+                    VerifyResults(values, searchValues[searchIndex], batchResults[searchIndex], MakeFns[makeIndex].name, BatchTestFns[testIndex].name);
+                }
+
+                timeTotal += duration.count();
+                printf("  %s %s : %f seconds\n", BatchTestFns[testIndex].name, MakeFns[makeIndex].name, duration.count());
+            }
+
+            double timePerGuess = (timeTotal * 1000.0 * 1000.0 * 1000.0f) / double(totalGuesses);
+            printf("%s total : %f seconds  (%zu guesses = %f nanoseconds per guess)\n\n", BatchTestFns[testIndex].name, timeTotal, totalGuesses, timePerGuess);
+        }
+
+        // hinted searches, on a random walk of search values, with the index found by each search as the hint for the next
+        std::vector<size_t> walkValues;
+        MakeSearchValues_RandomWalk(walkValues, c_perfTestNumSearches, c_maxValue, rng);
+        for (size_t testIndex = 0; testIndex < countof(HintedTestFns); ++testIndex)
+        {
+            double timeTotal = 0.0f;
+            size_t totalGuesses = 0;
+            for (size_t makeIndex = 0; makeIndex < countof(MakeFns); ++makeIndex)
+            {
+                MakeFns[makeIndex].fn(values, c_maxNumValues, c_maxValue, rng);
+
+                size_t hintIndex = c_maxNumValues / 2;
+
+                std::chrono::high_resolution_clock::time_point start = std::chrono::high_resolution_clock::now();
+
+                for (size_t searchValue : walkValues)
+                {
+                    TestResults ret = HintedTestFns[testIndex].fn(values, searchValue, hintIndex);
+                    hintIndex = ret.index;
+                    totalGuesses += ret.guesses;
+                }
+
+                std::chrono::high_resolution_clock::time_point end = std::chrono::high_resolution_clock::now();
+
+                std::chrono::duration<double> duration = std::chrono::duration_cast<std::chrono::duration<double>>(end - start);
+
+                timeTotal += duration.count();
+                printf("  %s %s : %f seconds\n", HintedTestFns[testIndex].name, MakeFns[makeIndex].name, duration.count());
+            }
+
+            double timePerGuess = (timeTotal * 1000.0 * 1000.0 * 1000.0f) / double(totalGuesses);
+            printf("%s total : %f seconds  (%zu guesses = %f nanoseconds per guess)\n\n", HintedTestFns[testIndex].name, timeTotal, totalGuesses, timePerGuess);
+        }
+
+        // range queries, for [low, low + width]
+        std::vector<size_t> rangeWidths(c_perfTestNumSearches);
+        {
+            std::uniform_int_distribution<size_t> dist(0, c_rangeQueryMaxWidth);
+            for (size_t& width : rangeWidths)
+                width = dist(rng);
+        }
+        for (size_t testIndex = 0; testIndex < countof(RangeTestFns); ++testIndex)
+        {
+            double timeTotal = 0.0f;
+            size_t totalGuesses = 0;
+            for (size_t makeIndex = 0; makeIndex < countof(MakeFns); ++makeIndex)
+            {
+                MakeFns[makeIndex].fn(values, c_maxNumValues, c_maxValue, rng);
+
+                size_t totalCount = 0;
+                std::chrono::high_resolution_clock::time_point start = std::chrono::high_resolution_clock::now();
+
+                for (size_t searchIndex = 0; searchIndex < searchValues.size(); ++searchIndex)
+                {
+                    RangeResults ret = RangeTestFns[testIndex].fn(values, searchValues[searchIndex], searchValues[searchIndex] + rangeWidths[searchIndex]);
+                    totalCount += ret.upperBound - ret.lowerBound;
+                    totalGuesses += ret.guesses;
+                }
+
+                std::chrono::high_resolution_clock::time_point end = std::chrono::high_resolution_clock::now();
+
+                std::chrono::duration<double> duration = std::chrono::duration_cast<std::chrono::duration<double>>(end - start);
+
+                #if VERIFY_RESULT()
+                for (size_t searchIndex = 0; searchIndex < searchValues.size(); ++searchIndex)
+                {
+                    size_t low = searchValues[searchIndex];
+                    size_t high = low + rangeWidths[searchIndex];
+                    RangeResults ret = RangeTestFns[testIndex].fn(values, low, high);
+                    if (ret.lowerBound != size_t(std::lower_bound(values.begin(), values.end(), low) - values.begin()) ||
+                        ret.upperBound != size_t(std::upper_bound(values.begin(), values.end(), high) - values.begin()))
+                    {
+                        printf("VERIFICATION FAILURE!! Wrong range for [%zu, %zu]! %s, %s\n", low, high, MakeFns[makeIndex].name, RangeTestFns[testIndex].name);
+                        break;
+                    }
+                }
+                #endif
+
+                timeTotal += duration.count();
+                printf("  %s %s : %f seconds (%zu values in the ranges)\n", RangeTestFns[testIndex].name, MakeFns[makeIndex].name, duration.count(), totalCount);
+            }
+
+            double timePerGuess = (timeTotal * 1000.0 * 1000.0 * 1000.0f) / double(totalGuesses);
+            printf("%s total : %f seconds  (%zu guesses = %f nanoseconds per guess)\n\n", RangeTestFns[testIndex].name, timeTotal, totalGuesses, timePerGuess);
+        }
+
+        #if PERF_TEST_KEY_TYPES()
+        PerfTestKeyType<uint32_t>("uint32_t", searchValues);
+        PerfTestKeyType<uint64_t>("uint64_t", searchValues);
+        PerfTestKeyType<float>("float", searchValues);
+        PerfTestKeyType<double>("double", searchValues);
+        #endif
+
+        #if BENCHMARK_HARNESS()
+        BenchmarkHarness(MakeFns, countof(MakeFns), TestFns, countof(TestFns), searchValues);
+        #endif
     }
 
+#if GENERATOR_TEST()
+    GeneratorTest(MakeFns, countof(MakeFns));
+#endif
+
+#if INTERPOLATION_PRECISION_TEST()
+    InterpolationPrecisionTest();
+#endif
+
+#if HOT_KEY_CACHE_TEST()
+    HotKeyCacheTest(TestFns, countof(TestFns), SearchValueFns, countof(SearchValueFns));
+#endif
+
+#if UPDATABLE_LIST_TEST()
+    UpdatableListTest(TestFns, countof(TestFns));
+#endif
+
+#if STRING_KEY_TEST()
+    StringKeyTest(TestFns, countof(TestFns));
+#endif
+
+#if COMPRESSED_LIST_TEST()
+    CompressedListTest(MakeFns, countof(MakeFns));
+#endif
+
+#if AUTO_TUNE_TEST()
+    AutoTuneTest();
+#endif
+
+#if PARALLEL_TEST()
+    ParallelTest(TestFns, countof(TestFns));
+#endif
+
+#if HUGE_PAGE_TEST()
+    HugePageTest();
+#endif
+
+#if MAPPED_FILE_TEST()
+    MappedFileTest();
+#endif
+
+#if SIZE_SWEEP()
+    SizeSweep(MakeFns, countof(MakeFns), TestFns, countof(TestFns));
+#endif
+
     system("pause");
 
     return 0;